@@ -0,0 +1,301 @@
+#ifndef VE281P1_DYNAMIC_HULL_HPP
+#define VE281P1_DYNAMIC_HULL_HPP
+
+#include "point.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/**
+ * A convex hull maintained under point insertions and deletions
+ * The hull is kept as a lower chain and an upper chain, both strictly convex and x-monotone
+ * The upper chain is stored as the lower chain of the negated points, so both use the same code
+ * The time complexity of functions are based on n and h
+ * n is the number of points inserted (and not erased)
+ * h is the number of hull vertices
+ */
+class DynamicHull {
+protected:
+    /**
+     * A strictly convex lower chain, sorted by x from left to right
+     */
+    class Chain {
+        std::map<int, int> chain;   // x -> y of each vertex
+
+    public:
+        /**
+         * Add p to the chain, dropping the vertices it hides
+         * Time complexity: Amortized O(log h)
+         * @return whether p became a vertex of the chain
+         */
+        bool insert(const Point &p) {
+            auto it = chain.lower_bound(p.x);
+            if (it != chain.end() && it->first == p.x) {
+                if (it->second <= p.y) return false;
+                it = chain.erase(it);
+            }
+            else if (it != chain.end() && it != chain.begin()) {
+                auto prev = std::prev(it);
+                if (ccw({prev->first, prev->second}, {it->first, it->second}, p) >= 0) return false;
+            }
+            auto cur = chain.emplace_hint(it, p.x, p.y);
+
+            //remove vertices on the right that are no longer convex
+            auto next = std::next(cur);
+            while (next != chain.end() && std::next(next) != chain.end()) {
+                auto nextNext = std::next(next);
+                if (ccw(p, {next->first, next->second}, {nextNext->first, nextNext->second}) > 0) break;
+                next = chain.erase(next);
+            }
+            //remove vertices on the left that are no longer convex
+            while (cur != chain.begin() && std::prev(cur) != chain.begin()) {
+                auto prev = std::prev(cur);
+                auto prevPrev = std::prev(prev);
+                if (ccw({prevPrev->first, prevPrev->second}, {prev->first, prev->second}, p) > 0) break;
+                chain.erase(prev);
+            }
+            return true;
+        }
+
+        /**
+         * Time complexity: O(log h)
+         * @return whether p lies on or above the chain (and inside its x range)
+         */
+        bool below(const Point &p) const {
+            auto it = chain.lower_bound(p.x);
+            if (it == chain.end()) return false;
+            if (it->first == p.x) return it->second <= p.y;
+            if (it == chain.begin()) return false;
+            auto prev = std::prev(it);
+            return ccw({prev->first, prev->second}, {it->first, it->second}, p) >= 0;
+        }
+
+        /**
+         * Time complexity: O(log h)
+         * @return whether p is a vertex of the chain
+         */
+        bool hasVertex(const Point &p) const {
+            auto it = chain.find(p.x);
+            return it != chain.end() && it->second == p.y;
+        }
+
+        void clear() { chain.clear(); }
+
+        bool empty() const { return chain.empty(); }
+
+        /**
+         * Time complexity: O(h)
+         * @return the vertices from left to right
+         */
+        std::vector<Point> vertices() const {
+            std::vector<Point> result;
+            result.reserve(chain.size());
+            for (auto &v : chain) result.push_back({v.first, v.second});
+            return result;
+        }
+    };
+
+    std::multiset<Point, PointLess> points;     // all live points, needed to rebuild after erasing a vertex
+    Chain lower;                                // lower chain
+    Chain upper;                                // upper chain, stored negated
+
+    mutable bool dirty = true;                  // whether the cached vertex arrays are out of date
+    mutable std::vector<Point> lowerCache;
+    mutable std::vector<Point> upperCache;      // negated, like upper
+    mutable std::vector<Point> hullCache;
+
+    static Point negate(const Point &p) { return {-p.x, -p.y}; }
+
+    /**
+     * Rebuild both chains from the live points
+     * Time complexity: O(n log h)
+     */
+    void rebuild() {
+        lower.clear();
+        upper.clear();
+        for (auto &p : points) {
+            lower.insert(p);
+            upper.insert(negate(p));
+        }
+        dirty = true;
+    }
+
+    /**
+     * Refresh the cached vertex arrays after a modification
+     * Time complexity: O(h)
+     */
+    void refresh() const {
+        if (!dirty) return;
+        lowerCache = lower.vertices();
+        upperCache = upper.vertices();
+
+        //counterclockwise: lower chain from left to right, then upper chain from right to left
+        hullCache = lowerCache;
+        for (auto &v : upperCache) {
+            Point p = negate(v);
+            if (!hullCache.empty() && hullCache.back().x == p.x && hullCache.back().y == p.y) continue;
+            hullCache.push_back(p);
+        }
+        if (hullCache.size() > 1 && hullCache.front().x == hullCache.back().x &&
+            hullCache.front().y == hullCache.back().y)
+            hullCache.pop_back();
+
+        //start from the lowest (then leftmost) vertex, as p1 prints it
+        auto first = std::min_element(hullCache.begin(), hullCache.end(), [](const Point &a, const Point &b) {
+            return a.y < b.y || (a.y == b.y && a.x < b.x);
+        });
+        std::rotate(hullCache.begin(), first, hullCache.end());
+        dirty = false;
+    }
+
+    /**
+     * Find the first index in [lo, hi) where pred becomes false, given pred is true then false
+     * Time complexity: O(log (hi - lo))
+     */
+    template<typename Pred>
+    static size_t partitionPoint(size_t lo, size_t hi, Pred pred) {
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (pred(mid)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    /**
+     * The edges of a lower chain that are visible from an outside point q form one contiguous run
+     * On each side of q.x the visibility is monotone, so the run is found by binary search
+     * Push the two vertices bounding the run into candidates
+     * Time complexity: O(log h)
+     */
+    static void visibleRun(const std::vector<Point> &v, const Point &q, std::vector<Point> &candidates) {
+        if (v.size() < 2) return;
+        size_t edges = v.size() - 1;
+        auto visible = [&](size_t i) { return ccw(v[i], v[i + 1], q) < 0; };
+        auto firstAtLeast = partitionPoint(0, v.size(), [&](size_t i) { return v[i].x < q.x; });
+        auto firstAfter = partitionPoint(0, v.size(), [&](size_t i) { return v[i].x <= q.x; });
+
+        //edges [0, left) end at or before q.x, edges [right, edges) start at or after q.x
+        size_t left = std::min(firstAfter > 0 ? firstAfter - 1 : 0, edges);
+        size_t right = std::min(firstAtLeast, edges);
+
+        size_t begin = partitionPoint(0, left, [&](size_t i) { return !visible(i); });
+        size_t end = partitionPoint(right, edges, visible);
+        if (begin == left) {
+            begin = edges;
+            for (size_t i = left; i < right; i++) {
+                if (visible(i)) {
+                    begin = i;
+                    break;
+                }
+            }
+            if (begin == edges && right < edges && visible(right)) begin = right;
+        }
+        if (begin == edges) return;
+        if (end == right) {
+            end = left;
+            for (size_t i = right; i > left; i--) {
+                if (visible(i - 1)) {
+                    end = i;
+                    break;
+                }
+            }
+        }
+        candidates.push_back(v[begin]);
+        candidates.push_back(v[end]);
+    }
+
+public:
+    DynamicHull() = default;
+
+    /**
+     * Insert a point
+     * Time complexity: Amortized O(log n)
+     * @return whether the hull changed
+     */
+    bool insert(const Point &p) {
+        points.insert(p);
+        bool changed = lower.insert(p);
+        changed = upper.insert(negate(p)) || changed;
+        if (changed) dirty = true;
+        return changed;
+    }
+
+    /**
+     * Erase one copy of a point, do nothing if it was never inserted
+     * Erasing an interior point costs O(log n), erasing a hull vertex rebuilds the chains
+     * Time complexity: O(log n) or O(n log h)
+     * @return whether the point existed
+     */
+    bool erase(const Point &p) {
+        auto it = points.find(p);
+        if (it == points.end()) return false;
+        points.erase(it);
+        if (points.count(p) > 0) return true;
+        if (lower.hasVertex(p) || upper.hasVertex(negate(p))) rebuild();
+        return true;
+    }
+
+    /**
+     * Time complexity: O(log h)
+     * @return whether q lies inside or on the boundary of the hull
+     */
+    bool contains(const Point &q) const {
+        return lower.below(q) && upper.below(negate(q));
+    }
+
+    /**
+     * Find the tangent points of the hull from an outside point q
+     * right is the vertex with every hull point on the left of (or on) the ray q->right
+     * left is the vertex with every hull point on the right of (or on) the ray q->left
+     * Time complexity: O(log h), plus O(h) once after each modification
+     * @return false if the hull is empty or q is inside it
+     */
+    bool tangents(const Point &q, Point &left, Point &right) const {
+        if (points.empty() || contains(q)) return false;
+        refresh();
+
+        //the tangent points bound the visible run on one of the chains, or are chain endpoints
+        std::vector<Point> candidates = {lowerCache.front(), lowerCache.back(),
+                                         negate(upperCache.front()), negate(upperCache.back())};
+        visibleRun(lowerCache, q, candidates);
+        size_t lowerEnd = candidates.size();
+        visibleRun(upperCache, negate(q), candidates);
+        for (size_t i = lowerEnd; i < candidates.size(); i++) candidates[i] = negate(candidates[i]);
+
+        left = right = candidates[0];
+        for (auto &c : candidates) {
+            if (ccw(q, right, c) < 0) right = c;
+            if (ccw(q, left, c) > 0) left = c;
+        }
+        return true;
+    }
+
+    /**
+     * Time complexity: O(1), plus O(h) once after each modification
+     * @return the hull vertices in counterclockwise order, starting from the lowest (then leftmost) one
+     */
+    const std::vector<Point> &hull() const {
+        refresh();
+        return hullCache;
+    }
+
+    /**
+     * @return the number of points in the structure
+     */
+    size_t size() const { return points.size(); }
+
+    bool empty() const { return points.empty(); }
+
+    void clear() {
+        points.clear();
+        lower.clear();
+        upper.clear();
+        dirty = true;
+    }
+};
+
+#endif //VE281P1_DYNAMIC_HULL_HPP
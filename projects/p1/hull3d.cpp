@@ -0,0 +1,30 @@
+#include <iostream>
+#include <vector>
+#include "hull3d.hpp"
+
+//Read num points from input
+void read(std::istream &in, std::vector<Point3> &points, int num){
+    points.resize(num);
+    for (auto &p : points) in>>p.x>>p.y>>p.z;
+}
+
+int main(){
+    //Read points from std::in
+    std::ios::sync_with_stdio(false);
+    std::vector<Point3> points;
+    int num;
+    std::cin>>num;
+    if (num<=0) return 0;
+    read(std::cin, points, num);
+
+    //build
+    ConvexHull3D hull(points);
+    auto faces = hull.build();
+
+    //output, one facet per line as the input indices of its vertices, counterclockwise seen from outside
+    for (auto &f : faces){
+        std::cout<<f[0]<<" "<<f[1]<<" "<<f[2]<<"\n";
+    }
+
+    return 0;
+}
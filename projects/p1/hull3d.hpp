@@ -0,0 +1,274 @@
+#ifndef VE281P1_HULL3D_HPP
+#define VE281P1_HULL3D_HPP
+
+#include "point.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+//Point3 struct definition
+typedef struct point3{
+    int x;
+    int y;
+    int z;
+} Point3;
+
+/**
+ * Convex hull of 3D points by QuickHull
+ * Faces are triangles stored in flat arrays as half-edges: face f owns half-edges 3f, 3f+1 and 3f+2,
+ * so the face and the next half-edge are computed from the index instead of stored
+ * Every point outside the current hull is kept in the outside set of one face it can see;
+ * when that face is removed the point moves to a new face that it sees, or is dropped as inside
+ * The next point inserted is always the furthest point of some outside set
+ * Coordinates are int and every orientation test is exact: it runs in double and falls back to 128-bit
+ * arithmetic only when the rounding error could change the sign
+ * The time complexity of functions are based on n, the number of points, and h, the number of hull vertices
+ */
+class ConvexHull3D {
+protected:
+    const std::vector<Point3> &points;
+
+    // half-edge arrays
+    std::vector<int> origin;        // start vertex of each half-edge
+    std::vector<int> twin;          // opposite half-edge in the neighbouring face
+    std::vector<char> alive;        // whether each face is still on the hull
+
+    // conflict graph, every point outside the hull is assigned to one face it can see
+    std::vector<std::vector<int>> outside;  // points assigned to each face
+    std::vector<int> assigned;              // face of each point, -1 once it is inserted or inside the hull
+    std::vector<int> furthest;              // the point of each outside set furthest from the face
+    std::vector<double> furthestVolume;     // and its volume, proportional to the distance
+    std::vector<int> pending;               // faces that may have a non-empty outside set
+
+    std::vector<int> horizonAt;     // per vertex, the p->v half-edge of the new face on the horizon edge v->w
+    std::vector<int> visitStamp;    // per face, the point whose insertion tested it
+    std::vector<char> visibleFlag;  // per face, the result of that test
+
+    static int face(int he) { return he / 3; }
+
+    static int next(int he) { return he % 3 == 2 ? he - 2 : he + 1; }
+
+    /**
+     * @return positive if d is on the outer side of the counterclockwise triangle abc, 0 if coplanar
+     */
+    static int128 volume(const Point3 &a, const Point3 &b, const Point3 &c, const Point3 &d) {
+        long long bx = (long long) b.x - a.x, by = (long long) b.y - a.y, bz = (long long) b.z - a.z;
+        long long cx = (long long) c.x - a.x, cy = (long long) c.y - a.y, cz = (long long) c.z - a.z;
+        long long dx = (long long) d.x - a.x, dy = (long long) d.y - a.y, dz = (long long) d.z - a.z;
+        int128 nx = (int128) by * cz - (int128) bz * cy;
+        int128 ny = (int128) bz * cx - (int128) bx * cz;
+        int128 nz = (int128) bx * cy - (int128) by * cx;
+        return nx * dx + ny * dy + nz * dz;
+    }
+
+    /**
+     * The sign of volume, computed in double and only recomputed exactly when the rounding error could flip it
+     * The differences of int coordinates are exact in double, so the error is below 8 ulp of the permanent
+     * @param approx set to the volume computed in double
+     */
+    static int side(const Point3 &a, const Point3 &b, const Point3 &c, const Point3 &d, double &approx) {
+        const double ERROR_BOUND = 8.0 * std::numeric_limits<double>::epsilon() / 2;
+        double bx = (double) b.x - (double) a.x, by = (double) b.y - (double) a.y, bz = (double) b.z - (double) a.z;
+        double cx = (double) c.x - (double) a.x, cy = (double) c.y - (double) a.y, cz = (double) c.z - (double) a.z;
+        double dx = (double) d.x - (double) a.x, dy = (double) d.y - (double) a.y, dz = (double) d.z - (double) a.z;
+        approx = (by * cz - bz * cy) * dx + (bz * cx - bx * cz) * dy + (bx * cy - by * cx) * dz;
+        double permanent = (std::fabs(by * cz) + std::fabs(bz * cy)) * std::fabs(dx) +
+                           (std::fabs(bz * cx) + std::fabs(bx * cz)) * std::fabs(dy) +
+                           (std::fabs(bx * cy) + std::fabs(by * cx)) * std::fabs(dz);
+        if (approx > ERROR_BOUND * permanent) return 1;
+        if (-approx > ERROR_BOUND * permanent) return -1;
+        int128 exact = volume(a, b, c, d);
+        return (exact > 0) - (exact < 0);
+    }
+
+    int side(int f, int p, double &approx) const {
+        return side(points[origin[3 * f]], points[origin[3 * f + 1]], points[origin[3 * f + 2]], points[p], approx);
+    }
+
+    bool visible(int f, int p) const {
+        double approx;
+        return side(f, p, approx) > 0;
+    }
+
+    int addFace(int a, int b, int c) {
+        int f = (int) alive.size();
+        origin.insert(origin.end(), {a, b, c});
+        twin.insert(twin.end(), {-1, -1, -1});
+        alive.push_back(1);
+        outside.emplace_back();
+        visitStamp.push_back(-1);
+        visibleFlag.push_back(0);
+        furthest.push_back(-1);
+        furthestVolume.push_back(0);
+        return f;
+    }
+
+    /**
+     * Assign q to the first face in faces that it can see, or drop it as inside the hull
+     */
+    void assign(int q, const std::vector<int> &faces) {
+        for (int f : faces) {
+            double v;
+            if (side(f, q, v) > 0) {
+                if (outside[f].empty()) pending.push_back(f);
+                outside[f].push_back(q);
+                assigned[q] = f;
+                //v is only the double approximation, so the first point of a face is recorded whatever its sign
+                if (furthest[f] < 0 || v > furthestVolume[f]) furthestVolume[f] = v, furthest[f] = q;
+                return;
+            }
+        }
+        assigned[q] = -1;
+    }
+
+    /**
+     * Choose four extreme points that span a tetrahedron, so few points remain outside of it
+     * @return false if all points are coplanar
+     */
+    bool initialTetrahedron(std::array<int, 4> &t) const {
+        int n = (int) points.size();
+        auto less = [&](int i, int j) {
+            return std::tie(points[i].x, points[i].y, points[i].z) < std::tie(points[j].x, points[j].y, points[j].z);
+        };
+        int a = 0, b = 0;
+        for (int i = 1; i < n; i++) {
+            if (less(i, a)) a = i;
+            if (less(b, i)) b = i;
+        }
+        if (a == b) return false;
+
+        //farthest from the line ab
+        int c = -1;
+        int128 best = 0;
+        for (int i = 0; i < n; i++) {
+            long long ux = (long long) points[b].x - points[a].x, uy = (long long) points[b].y - points[a].y,
+                    uz = (long long) points[b].z - points[a].z;
+            long long vx = (long long) points[i].x - points[a].x, vy = (long long) points[i].y - points[a].y,
+                    vz = (long long) points[i].z - points[a].z;
+            int128 nx = (int128) uy * vz - (int128) uz * vy;
+            int128 ny = (int128) uz * vx - (int128) ux * vz;
+            int128 nz = (int128) ux * vy - (int128) uy * vx;
+            int128 area = (nx < 0 ? -nx : nx) + (ny < 0 ? -ny : ny) + (nz < 0 ? -nz : nz);
+            if (area > best) best = area, c = i;
+        }
+        if (c == -1) return false;
+
+        //farthest from the plane abc
+        int d = -1;
+        best = 0;
+        for (int i = 0; i < n; i++) {
+            int128 v = volume(points[a], points[b], points[c], points[i]);
+            if (v < 0) v = -v;
+            if (v > best) best = v, d = i;
+        }
+        if (d == -1) return false;
+        t = {a, b, c, d};
+        return true;
+    }
+
+    /**
+     * Insert point p, which can see the face it is assigned to
+     */
+    void insert(int p) {
+        //the visible faces are connected, search them from the assigned face
+        std::vector<int> visibleFaces = {assigned[p]};
+        std::vector<int> horizon;
+        visitStamp[assigned[p]] = p;
+        visibleFlag[assigned[p]] = 1;
+        for (size_t i = 0; i < visibleFaces.size(); i++) {
+            int f = visibleFaces[i];
+            for (int he = 3 * f; he < 3 * f + 3; he++) {
+                int g = face(twin[he]);
+                if (visitStamp[g] != p) {
+                    visitStamp[g] = p;
+                    visibleFlag[g] = visible(g, p);
+                    if (visibleFlag[g]) visibleFaces.push_back(g);
+                }
+                //the horizon is every edge between a visible face and a hidden face
+                if (!visibleFlag[g]) horizon.push_back(he);
+            }
+        }
+
+        //a new face (u, v, p) for each horizon edge u->v, keeping the orientation of the visible face
+        std::vector<int> newFaces;
+        for (int he : horizon) {
+            int u = origin[he], v = origin[next(he)];
+            int g = addFace(u, v, p);
+            newFaces.push_back(g);
+            twin[3 * g] = twin[he];
+            twin[twin[he]] = 3 * g;
+            horizonAt[u] = 3 * g + 2;
+        }
+        for (int g : newFaces) {
+            int v = origin[3 * g + 1];
+            twin[3 * g + 1] = horizonAt[v];
+            twin[horizonAt[v]] = 3 * g + 1;
+        }
+
+        //a point that saw a visible face either sees a new face or is inside the new hull
+        assigned[p] = -1;
+        for (int f : visibleFaces) {
+            alive[f] = 0;
+            for (int q : outside[f]) {
+                if (q != p) assign(q, newFaces);
+            }
+            std::vector<int>().swap(outside[f]);
+        }
+    }
+
+public:
+    explicit ConvexHull3D(const std::vector<Point3> &points) : points(points) {}
+
+    /**
+     * Build the hull
+     * Time complexity: O(n log h) on typical inputs, O(n^2) in the worst case
+     * @return the faces as counterclockwise (seen from outside) triples of point indices,
+     *         empty if all points are coplanar
+     */
+    std::vector<std::array<int, 3>> build() {
+        int n = (int) points.size();
+        std::vector<std::array<int, 3>> result;
+        std::array<int, 4> t;
+        if (n < 4 || !initialTetrahedron(t)) return result;
+
+        assigned.assign(n, -1);
+        horizonAt.assign(n, -1);
+
+        //the tetrahedron, every face oriented so that the remaining vertex is behind it
+        const int sides[4][3] = {{0, 1, 2}, {0, 3, 1}, {1, 3, 2}, {0, 2, 3}};
+        for (auto &side : sides) {
+            int a = t[side[0]], b = t[side[1]], c = t[side[2]];
+            int d = t[6 - side[0] - side[1] - side[2]];
+            if (volume(points[a], points[b], points[c], points[d]) > 0) std::swap(b, c);
+            addFace(a, b, c);
+        }
+        for (int he = 0; he < 12; he++) {
+            for (int other = 0; other < 12; other++) {
+                if (origin[he] == origin[next(other)] && origin[next(he)] == origin[other]) twin[he] = other;
+            }
+        }
+
+        const std::vector<int> tetrahedron = {0, 1, 2, 3};
+        for (int p = 0; p < n; p++) {
+            if (p != t[0] && p != t[1] && p != t[2] && p != t[3]) assign(p, tetrahedron);
+        }
+
+        //always insert the point furthest from its face, which drops the most points inside the hull
+        while (!pending.empty()) {
+            int f = pending.back();
+            pending.pop_back();
+            if (alive[f] && !outside[f].empty()) insert(furthest[f]);
+        }
+
+        for (int f = 0; f < (int) alive.size(); f++) {
+            if (alive[f]) result.push_back({origin[3 * f], origin[3 * f + 1], origin[3 * f + 2]});
+        }
+        return result;
+    }
+};
+
+#endif //VE281P1_HULL3D_HPP
@@ -0,0 +1,286 @@
+#ifndef VE281P1_HULL_QUERY_HPP
+#define VE281P1_HULL_QUERY_HPP
+
+#include "point.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Point location and extreme point queries over a convex hull
+ * The hull is the vector S printed by p1: counterclockwise, starting from the lowest (then leftmost) vertex,
+ * without collinear vertices
+ * The single queries are exact for every coordinate type, through ccw and dotOrder (point.hpp)
+ * The batched queries run BATCH binary searches in lock-step in double arithmetic, which the compiler turns into
+ * SIMD code (gathers and multiplies over the lanes, e.g. with -O3 -mavx2 -mfma); this is exact only for integer
+ * coordinates whose hull fits in a box of side EXACT_RANGE, so other hulls answer the batches one query at a time
+ * The time complexity of functions are based on h, the number of hull vertices
+ * @tparam T coordinate type
+ */
+template<typename T>
+class BasicHullQuery {
+public:
+    typedef BasicPoint<T> PointType;
+
+protected:
+    static constexpr size_t BATCH = 16;             // number of queries searched in lock-step by the batched functions
+    // products of two numbers of at most 2^26 are exact in double, and so is the difference of two of them
+    static constexpr long long EXACT_RANGE = 1ll << 26;
+
+    std::vector<PointType> hull;
+    T minX, maxX, minY, maxY;                       // bounding box of the hull
+    bool exact;                                     // whether the batched functions can use the double arrays
+    // structure-of-arrays copies used by the batched functions, exact small integers
+    std::vector<double> vx, vy;                     // vertices relative to hull[0]
+    std::vector<double> ex, ey;                     // edge vectors, edge i goes from hull[i] to hull[i+1]
+
+    static double cross(double ax, double ay, double bx, double by) {
+        return ax * by - ay * bx;
+    }
+
+    // 0 for angles in [0, pi), 1 for angles in [pi, 2pi)
+    static int half(double x, double y) {
+        return (y < 0) | ((y == 0) & (x < 0));
+    }
+
+    // whether the angle of a is strictly less than the angle of b, both in [0, 2pi)
+    static bool angleLess(double ax, double ay, double bx, double by) {
+        int ha = half(ax, ay), hb = half(bx, by);
+        return (ha < hb) | ((ha == hb) & (cross(ax, ay, bx, by) > 0));
+    }
+
+    /**
+     * Whether the angle of edge i is strictly less than the angle of d rotated by 90 degrees, exact for any T
+     * The rotated direction is (-d.y, d.x), so the cross product of the edge and it is the dot product with d
+     */
+    bool edgeBefore(size_t i, const PointType &d) const {
+        const PointType &a = hull[i], &b = hull[(i + 1) % hull.size()];
+        int he = (b.y < a.y) | ((b.y == a.y) & (b.x < a.x));
+        int hd = (d.x < 0) | ((d.x == 0) & (d.y > 0));
+        return (he < hd) | ((he == hd) & (dotOrder(a, b, d) > 0));
+    }
+
+    bool containsSmall(const PointType &q) const {
+        if (hull.size() == 1) return q.x == hull[0].x && q.y == hull[0].y;
+        const PointType &a = hull[0], &b = hull[1];
+        return ccw(a, b, q) == 0 && std::min(a.x, b.x) <= q.x && q.x <= std::max(a.x, b.x) &&
+               std::min(a.y, b.y) <= q.y && q.y <= std::max(a.y, b.y);
+    }
+
+    static bool smallDirection(const PointType &d) {
+        return -EXACT_RANGE <= d.x && d.x <= EXACT_RANGE && -EXACT_RANGE <= d.y && d.y <= EXACT_RANGE;
+    }
+
+public:
+    /**
+     * Time complexity: O(h)
+     * @throw std::invalid_argument if S is empty
+     * @param S hull vertices in the order p1 prints them
+     */
+    explicit BasicHullQuery(const std::vector<PointType> &S) : hull(S) {
+        if (hull.empty()) throw std::invalid_argument("empty hull");
+        size_t h = hull.size();
+        minX = maxX = hull[0].x;
+        minY = maxY = hull[0].y;
+        for (const auto &p : hull) {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        exact = false;
+        if constexpr (std::is_integral<T>::value) {
+            exact = (int128) maxX - minX <= EXACT_RANGE && (int128) maxY - minY <= EXACT_RANGE;
+        }
+        if (!exact) return;
+        vx.resize(h);
+        vy.resize(h);
+        ex.resize(h);
+        ey.resize(h);
+        for (size_t i = 0; i < h; i++) {
+            vx[i] = (double) ((long long) hull[i].x - (long long) hull[0].x);
+            vy[i] = (double) ((long long) hull[i].y - (long long) hull[0].y);
+            ex[i] = (double) ((long long) hull[(i + 1) % h].x - (long long) hull[i].x);
+            ey[i] = (double) ((long long) hull[(i + 1) % h].y - (long long) hull[i].y);
+        }
+    }
+
+    /**
+     * Binary search for the triangle of the fan around hull[0] that contains q
+     * Time complexity: O(log h)
+     * @return whether q is inside or on the boundary of the hull
+     */
+    bool contains(const PointType &q) const {
+        size_t h = hull.size();
+        if (h < 3) return containsSmall(q);
+        if (ccw(hull[0], hull[1], q) < 0 || ccw(hull[0], hull[h - 1], q) > 0) return false;
+        //the last i in [1, h-2] with q on the left of hull[0]->hull[i]
+        size_t lo = 1, hi = h - 2;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo + 1) / 2;
+            if (ccw(hull[0], hull[mid], q) >= 0) lo = mid;
+            else hi = mid - 1;
+        }
+        return ccw(hull[lo], hull[lo + 1], q) >= 0;
+    }
+
+    /**
+     * The edge angles increase from hull[0] around the hull, so the extreme vertex in direction d is the start
+     * of the first edge whose angle is not less than the angle of d rotated by 90 degrees
+     * Time complexity: O(log h)
+     * @param d direction, must not be zero
+     * @return a vertex v maximizing the dot product of v and d
+     */
+    const PointType &extreme(const PointType &d) const {
+        size_t h = hull.size();
+        size_t base = 0, len = h;
+        while (len > 1) {
+            size_t half = len / 2;
+            if (edgeBefore(base + half - 1, d)) base += half;
+            len -= half;
+        }
+        base += edgeBefore(base, d);
+        return hull[base % h];
+    }
+
+    /**
+     * Answer contains for n queries
+     * Every query runs the same number of binary search steps without branches, BATCH queries at a time over
+     * all BATCH lanes (a short block repeats its first query), so each step is one vectorizable loop and the
+     * cache misses of a block overlap
+     * A query outside the bounding box of the hull is clamped into it, which keeps the arithmetic exact,
+     * and answered false
+     * Time complexity: O(n log h)
+     */
+    void containsBatch(const PointType *queries, size_t n, bool *out) const {
+        size_t h = hull.size();
+        if (h < 3 || !exact) {
+            for (size_t i = 0; i < n; i++) out[i] = contains(queries[i]);
+            return;
+        }
+        const double *vxs = vx.data(), *vys = vy.data(), *exs = ex.data(), *eys = ey.data();
+        double qx[BATCH], qy[BATCH];
+        long long base[BATCH];
+        bool inBox[BATCH];
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            for (size_t l = 0; l < BATCH; l++) {
+                const PointType &q = queries[start + (l < count ? l : 0)];
+                T x = std::min(std::max(q.x, minX), maxX), y = std::min(std::max(q.y, minY), maxY);
+                inBox[l] = x == q.x && y == q.y;
+                qx[l] = (double) ((long long) x - (long long) hull[0].x);
+                qy[l] = (double) ((long long) y - (long long) hull[0].y);
+                base[l] = 1;
+            }
+            size_t len = h - 2;
+            while (len > 1) {
+                long long half = (long long) (len / 2);
+                for (size_t l = 0; l < BATCH; l++) {
+                    long long mid = base[l] + half;
+                    base[l] = cross(vxs[mid], vys[mid], qx[l], qy[l]) >= 0 ? mid : base[l];
+                }
+                len -= (size_t) half;
+            }
+            for (size_t l = 0; l < count; l++) {
+                long long i = base[l];
+                bool inFan = (cross(vxs[1], vys[1], qx[l], qy[l]) >= 0) &
+                             (cross(vxs[h - 1], vys[h - 1], qx[l], qy[l]) <= 0);
+                bool inEdge = cross(exs[i], eys[i], qx[l] - vxs[i], qy[l] - vys[i]) >= 0;
+                out[start + l] = inBox[l] & inFan & inEdge;
+            }
+        }
+    }
+
+    /**
+     * Answer extreme for n directions, in the same lock-step way as containsBatch
+     * A block with a direction component larger than EXACT_RANGE is answered one direction at a time
+     * Time complexity: O(n log h)
+     */
+    void extremeBatch(const PointType *directions, size_t n, PointType *out) const {
+        size_t h = hull.size();
+        if (!exact) {
+            for (size_t i = 0; i < n; i++) out[i] = extreme(directions[i]);
+            return;
+        }
+        const double *exs = ex.data(), *eys = ey.data();
+        double tx[BATCH], ty[BATCH];
+        long long base[BATCH];
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            if (!std::all_of(directions + start, directions + start + count, smallDirection)) {
+                for (size_t l = 0; l < count; l++) out[start + l] = extreme(directions[start + l]);
+                continue;
+            }
+            for (size_t l = 0; l < BATCH; l++) {
+                const PointType &d = directions[start + (l < count ? l : 0)];
+                tx[l] = -(double) d.y;
+                ty[l] = (double) d.x;
+                base[l] = 0;
+            }
+            size_t len = h;
+            while (len > 1) {
+                long long half = (long long) (len / 2);
+                for (size_t l = 0; l < BATCH; l++) {
+                    long long mid = base[l] + half - 1;
+                    base[l] = angleLess(exs[mid], eys[mid], tx[l], ty[l]) ? base[l] + half : base[l];
+                }
+                len -= (size_t) half;
+            }
+            for (size_t l = 0; l < count; l++) {
+                size_t i = (size_t) base[l] + angleLess(exs[base[l]], eys[base[l]], tx[l], ty[l]);
+                out[start + l] = hull[i % h];
+            }
+        }
+    }
+
+    /**
+     * Split the queries into one contiguous range per thread and run containsBatch on each
+     * Time complexity: O(n log h / threads)
+     */
+    void containsParallel(const PointType *queries, size_t n, bool *out,
+                          unsigned threads = std::thread::hardware_concurrency()) const {
+        forEachRange(n, threads, [&](size_t begin, size_t end) {
+            containsBatch(queries + begin, end - begin, out + begin);
+        });
+    }
+
+    /**
+     * Split the directions into one contiguous range per thread and run extremeBatch on each
+     * Time complexity: O(n log h / threads)
+     */
+    void extremeParallel(const PointType *directions, size_t n, PointType *out,
+                         unsigned threads = std::thread::hardware_concurrency()) const {
+        forEachRange(n, threads, [&](size_t begin, size_t end) {
+            extremeBatch(directions + begin, end - begin, out + begin);
+        });
+    }
+
+    /**
+     * @return the hull vertices
+     */
+    const std::vector<PointType> &vertices() const { return hull; }
+
+protected:
+    template<typename Function>
+    static void forEachRange(size_t n, unsigned threads, Function function) {
+        if (threads == 0) threads = 1;
+        size_t step = (n + threads - 1) / threads;
+        if (threads == 1 || step < BATCH) {
+            function(0, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t begin = step; begin < n; begin += step) {
+            workers.emplace_back(function, begin, std::min(n, begin + step));
+        }
+        function(0, std::min(n, step));
+        for (auto &worker : workers) worker.join();
+    }
+};
+
+typedef BasicHullQuery<int> HullQuery;
+
+#endif //VE281P1_HULL_QUERY_HPP
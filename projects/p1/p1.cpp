@@ -1,37 +1,36 @@
 #include <iostream>
 #include <vector>
 #include "sort.hpp"
+#include "point.hpp"
 #include <algorithm>
-
-//Point struct definition
-typedef struct point{
-    int x;
-    int y;
-} Point;
-
-//cww function
-int ccw(Point a, Point b, Point c){
-    return (b.x-a.x)*(c.y-a.y)-(b.y-a.y)*(c.x-a.x);
-}
+#include <cstdlib>
+#include <limits>
+#include <string>
 
 //Compare function object
+template<typename T>
 struct CompareLess{
-    Point p0;
-    bool operator()(const Point &lhs, const Point &rhs) const {
-        if (lhs.x==p0.x&&lhs.y==p0.y) return true; 
-        return ccw(p0, lhs, rhs)>0;
+    BasicPoint<T> p0;
+    bool operator()(const BasicPoint<T> &lhs, const BasicPoint<T> &rhs) const {
+        int turn = ccw(p0, lhs, rhs);
+        if (turn!=0) return turn>0;
+        //same angle: the closer point goes first, so the scan drops it and keeps the farther one
+        //p0 is the lowest (then leftmost) point, so on one ray the closer point is the lower (then left) one
+        if (lhs.y!=rhs.y) return lhs.y<rhs.y;
+        return lhs.x<rhs.x;
     }
 };
 
 //Read from input and return p0
-Point read(std::istream &in, std::vector<Point> &points, int num){
+template<typename T>
+BasicPoint<T> read(std::istream &in, std::vector<BasicPoint<T>> &points, int num){
 
-    Point smallest;
+    BasicPoint<T> smallest;
     if(num>=1) in>>smallest.x>>smallest.y;
     points.push_back(smallest);
 
     for (int i=1;i<num;i++){
-        Point temp;
+        BasicPoint<T> temp;
         in>>temp.x>>temp.y;
         if (temp.y<smallest.y) smallest = temp;
         else if(temp.y==smallest.y){
@@ -42,20 +41,15 @@ Point read(std::istream &in, std::vector<Point> &points, int num){
     return smallest;
 }
 
-int main(){
-    //Read points from std::in and get p0
-    std::vector<Point> points;
-    int num;
-    std::cin>>num;
-    if (num<=0) return 0;
-    Point p0 = read(std::cin, points, num);
-
+//Graham scan over points sorted around p0, return the hull S
+template<typename T>
+std::vector<BasicPoint<T>> scan(std::vector<BasicPoint<T>> &points, BasicPoint<T> p0){
     //sort
-    CompareLess compressless = {p0};
+    CompareLess<T> compressless = {p0};
     std::sort(points.begin(), points.end(), compressless);
 
     //iterate
-    std::vector<Point> S;
+    std::vector<BasicPoint<T>> S;
     for (auto i = points.begin(); i<points.end(); i++){
         while(S.size()>1 && ccw(S[S.size()-2], S[S.size()-1], *i)<=0){
             S.pop_back();
@@ -65,11 +59,68 @@ int main(){
 
     //special cases
     if(S.size()==2&&(S[0].x==S[1].x&&S[0].y==S[1].y)) S.pop_back();
+    return S;
+}
+
+//Read num points chunk by chunk, merging each chunk into the running hull
+//Only the hull and one chunk are kept in memory
+template<typename T>
+std::vector<BasicPoint<T>> streamScan(std::istream &in, int num, int chunk){
+    std::vector<BasicPoint<T>> S;
+    std::vector<BasicPoint<T>> points;
+    while(num>0){
+        int count = std::min(num, chunk);
+        num -= count;
+
+        //the previous hull starts with its lowest point, so p0 is either S[0] or the lowest point of the chunk
+        points.assign(S.begin(), S.end());
+        BasicPoint<T> p0 = read(in, points, count);
+        if (!S.empty() && (S[0].y<p0.y || (S[0].y==p0.y && S[0].x<p0.x))) p0 = S[0];
+        S = scan(points, p0);
+    }
+    return S;
+}
+
+//Read the points with coordinate type T, print the hull
+template<typename T>
+void run(std::istream &in, std::ostream &out, int num, bool stream, int chunk){
+    std::vector<BasicPoint<T>> S;
+    if (stream) S = streamScan<T>(in, num, chunk);
+    else {
+        //Read points from std::in and get p0
+        std::vector<BasicPoint<T>> points;
+        BasicPoint<T> p0 = read(in, points, num);
+        S = scan(points, p0);
+    }
 
     //output
+    out.precision(std::numeric_limits<T>::max_digits10);
     for(auto i = S.begin(); i<S.end();i++){
-        std::cout<<i->x<<" "<<i->y<<"\n";
+        out<<i->x<<" "<<i->y<<"\n";
+    }
+}
+
+int main(int argc, char *argv[]){
+    //"--stream [chunk]" reads the points in chunks of the given size
+    //"--double" reads floating point coordinates instead of integers
+    const int DEFAULT_CHUNK = 1<<20;
+    bool stream = false, floating = false;
+    int chunk = DEFAULT_CHUNK;
+    for (int i=1;i<argc;i++){
+        std::string arg = argv[i];
+        if (arg=="--double") floating = true;
+        else if (arg=="--stream"){
+            stream = true;
+            if (i+1<argc && std::atoi(argv[i+1])>0) chunk = std::atoi(argv[++i]);
+        }
     }
 
+    int num;
+    std::cin>>num;
+    if (num<=0) return 0;
+
+    if (floating) run<double>(std::cin, std::cout, num, stream, chunk);
+    else run<long long>(std::cin, std::cout, num, stream, chunk);
+
     return 0;
-}
\ No newline at end of file
+}
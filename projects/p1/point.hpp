@@ -0,0 +1,178 @@
+#ifndef VE281P1_POINT_HPP
+#define VE281P1_POINT_HPP
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+__extension__ typedef __int128 int128;
+
+//Point struct definition, for any integer or floating point coordinate type
+template<typename T>
+struct BasicPoint{
+    T x;
+    T y;
+};
+
+typedef BasicPoint<int> Point;
+
+//Exact arithmetic on expansions: sums of doubles that do not overlap, stored in increasing magnitude
+namespace Expansion {
+    //x + y == a + b exactly
+    inline void twoSum(double a, double b, double &x, double &y){
+        x = a+b;
+        double bVirtual = x-a;
+        double aVirtual = x-bVirtual;
+        y = (a-aVirtual)+(b-bVirtual);
+    }
+
+    //x + y == a * b exactly
+    inline void twoProduct(double a, double b, double &x, double &y){
+        x = a*b;
+        y = std::fma(a, b, -x);
+    }
+
+    //add b to the expansion e of length n in place, return the new length (zero components are dropped)
+    inline int grow(double *e, int n, double b){
+        int length = 0;
+        for (int i=0;i<n;i++){
+            double low;
+            twoSum(b, e[i], b, low);
+            if (low!=0) e[length++] = low;
+        }
+        if (b!=0 || length==0) e[length++] = b;
+        return length;
+    }
+
+    //the sign of an expansion is the sign of its largest component
+    inline int sign(const double *e, int n){
+        return e[n-1]>0 ? 1 : (e[n-1]<0 ? -1 : 0);
+    }
+
+    //split a coordinate into doubles that add up to it exactly, return how many are used
+    template<typename T>
+    int split(T v, double *parts){
+        if constexpr (std::is_floating_point<T>::value){
+            parts[0] = (double) v;
+            return 1;
+        }
+        else{
+            //the high and low 32 bits are both exact in double
+            long long value = (long long) v;
+            long long high = value/(1ll<<32)*(1ll<<32);
+            parts[0] = (double) high;
+            parts[1] = (double) (value-high);
+            return 2;
+        }
+    }
+
+    //exact sign of the sum of signs[i]*terms[i][0]*terms[i][1] over at most six products
+    template<typename T>
+    int productSumSign(const T *const terms[][2], const double *signs, int n){
+        double e[64];
+        int length = 0;
+        for (int i=0;i<n;i++){
+            double u[2], v[2];
+            int nu = split(*terms[i][0], u), nv = split(*terms[i][1], v);
+            for (int j=0;j<nu;j++){
+                for (int k=0;k<nv;k++){
+                    double high, low;
+                    twoProduct(signs[i]*u[j], v[k], high, low);
+                    length = grow(e, length, low);
+                    length = grow(e, length, high);
+                }
+            }
+        }
+        return sign(e, length);
+    }
+
+    //exact sign of the orientation determinant, expanded into six products of coordinates
+    template<typename T>
+    int orientation(const BasicPoint<T> &a, const BasicPoint<T> &b, const BasicPoint<T> &c){
+        //a.x*b.y - a.x*c.y - a.y*b.x + a.y*c.x + b.x*c.y - b.y*c.x
+        const T *terms[6][2] = {{&a.x, &b.y}, {&a.x, &c.y}, {&a.y, &b.x}, {&a.y, &c.x}, {&b.x, &c.y}, {&b.y, &c.x}};
+        const double signs[6] = {1, -1, -1, 1, 1, -1};
+        return productSumSign(terms, signs, 6);
+    }
+
+    //exact sign of dot(b-a, d), expanded into four products of coordinates
+    template<typename T>
+    int dotOrder(const BasicPoint<T> &a, const BasicPoint<T> &b, const BasicPoint<T> &d){
+        const T *terms[4][2] = {{&b.x, &d.x}, {&b.y, &d.y}, {&a.x, &d.x}, {&a.y, &d.y}};
+        const double signs[4] = {1, 1, -1, -1};
+        return productSumSign(terms, signs, 4);
+    }
+}
+
+/**
+ * The orientation of the triangle abc
+ * int (and smaller) coordinates are exact in 128-bit integers
+ * 64-bit integer and floating point coordinates are computed in double first, with an error bound;
+ * only when the result is too close to zero it is recomputed exactly with expansions
+ * @return 1 if abc turns counterclockwise, -1 if clockwise, 0 if collinear
+ */
+template<typename T>
+int orientation(const BasicPoint<T> &a, const BasicPoint<T> &b, const BasicPoint<T> &c){
+    if constexpr (std::is_integral<T>::value && sizeof(T)<=4){
+        int128 det = (int128) ((long long) b.x-a.x)*((long long) c.y-a.y)-(int128) ((long long) b.y-a.y)*((long long) c.x-a.x);
+        return (det>0)-(det<0);
+    }
+    else{
+        //differences and products round once each, the subtraction once more
+        const double ERROR_BOUND = 4*std::numeric_limits<double>::epsilon();
+        double left, right;
+        if constexpr (std::is_integral<T>::value){
+            left = (double) ((int128) b.x-a.x)*(double) ((int128) c.y-a.y);
+            right = (double) ((int128) b.y-a.y)*(double) ((int128) c.x-a.x);
+        }
+        else{
+            left = ((double) b.x-(double) a.x)*((double) c.y-(double) a.y);
+            right = ((double) b.y-(double) a.y)*((double) c.x-(double) a.x);
+        }
+        double det = left-right;
+        double bound = ERROR_BOUND*(std::fabs(left)+std::fabs(right));
+        if (det>bound) return 1;
+        if (-det>bound) return -1;
+        return Expansion::orientation(a, b, c);
+    }
+}
+
+/**
+ * The order of a and b along the direction d, exact in the same way as orientation
+ * @return 1 if b is further than a in direction d, -1 if a is further, 0 if they are as far
+ */
+template<typename T>
+int dotOrder(const BasicPoint<T> &a, const BasicPoint<T> &b, const BasicPoint<T> &d){
+    if constexpr (std::is_integral<T>::value && sizeof(T)<=4){
+        int128 dot = (int128) ((long long) b.x-a.x)*d.x+(int128) ((long long) b.y-a.y)*d.y;
+        return (dot>0)-(dot<0);
+    }
+    else{
+        //products round once each, the three additions once more each, and integers round when converted
+        const double ERROR_BOUND = 8*std::numeric_limits<double>::epsilon();
+        double terms[4] = {(double) b.x*(double) d.x, (double) b.y*(double) d.y,
+                           -(double) a.x*(double) d.x, -(double) a.y*(double) d.y};
+        double dot = (terms[0]+terms[1])+(terms[2]+terms[3]);
+        double bound = ERROR_BOUND*(std::fabs(terms[0])+std::fabs(terms[1])+std::fabs(terms[2])+std::fabs(terms[3]));
+        if (dot>bound) return 1;
+        if (-dot>bound) return -1;
+        return Expansion::dotOrder(a, b, d);
+    }
+}
+
+//cww function, return the sign of the turn
+template<typename T>
+int ccw(const BasicPoint<T> &a, const BasicPoint<T> &b, const BasicPoint<T> &c){
+    return orientation(a, b, c);
+}
+
+//Lexicographic order on (x, y)
+struct PointLess{
+    template<typename T>
+    bool operator()(const BasicPoint<T> &lhs, const BasicPoint<T> &rhs) const {
+        if (lhs.x!=rhs.x) return lhs.x<rhs.x;
+        return lhs.y<rhs.y;
+    }
+};
+
+#endif //VE281P1_POINT_HPP
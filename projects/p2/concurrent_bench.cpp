@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "concurrent_hashtable.hpp"
+#include "hashtable.hpp"
+
+//Throughput of ConcurrentHashTable against a HashTable behind one mutex, for a read-mostly and a 50/50 mix
+//Usage: concurrent_bench [max threads] [operations per thread] [keys]
+//Every thread count from 1 up to max threads (doubling) is run, the keys are preloaded
+
+const int READ_PERCENTS[] = {95, 50};
+
+//A HashTable and the lock that every operation takes
+struct LockedTable {
+    std::mutex mutex;
+    HashTable<long long, long long> table;
+
+    bool find(long long key, long long &value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = table.find(key);
+        if (it == table.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    void insert(long long key, long long value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        table.insert(key, value);
+    }
+};
+
+//Run ops operations on each of threads threads, return millions of operations per second
+template<typename Table>
+double run(Table &table, int threads, int ops, long long keys, int readPercent){
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t=0;t<threads;t++){
+        workers.emplace_back([&table, t, ops, keys, readPercent](){
+            std::mt19937_64 random((unsigned long long) t+1);
+            long long value, found = 0;
+            for (int i=0;i<ops;i++){
+                auto r = random();
+                long long key = (long long) (r%(unsigned long long) keys);
+                if ((int) ((r>>40)%100)<readPercent) found += table.find(key, value);
+                else table.insert(key, (long long) i);
+            }
+            if (found<0) std::cout<<found;
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    return (double) threads*ops/seconds/1e6;
+}
+
+int main(int argc, char *argv[]){
+    int maxThreads = argc>1 ? std::atoi(argv[1]) : (int) std::max(1u, std::thread::hardware_concurrency());
+    int ops = argc>2 ? std::atoi(argv[2]) : 1000000;
+    long long keys = argc>3 ? std::atoll(argv[3]) : 1000000;
+
+    std::cout<<"reads%\tthreads\tconcurrent Mops/s\tlocked Mops/s\n";
+    for (int readPercent : READ_PERCENTS){
+        for (int threads=1;threads<=maxThreads;threads*=2){
+            ConcurrentHashTable<long long, long long> concurrent(2*(size_t) keys);
+            LockedTable locked;
+            for (long long k=0;k<keys;k+=2){
+                concurrent.insert(k, k);
+                locked.table.insert(k, k);
+            }
+            double a = run(concurrent, threads, ops, keys, readPercent);
+            double b = run(locked, threads, ops, keys, readPercent);
+            std::cout<<readPercent<<"\t"<<threads<<"\t"<<a<<"\t"<<b<<"\n";
+        }
+    }
+    return 0;
+}
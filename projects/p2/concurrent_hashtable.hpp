@@ -0,0 +1,318 @@
+#ifndef VE281P2_CONCURRENT_HASHTABLE_HPP
+#define VE281P2_CONCURRENT_HASHTABLE_HPP
+
+#include "epoch.hpp"
+#include "hash_prime.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * A hashtable that can be used by many threads at the same time
+ * The buckets are singly linked lists as in HashTable (hashtable.hpp), with atomic links
+ * - Readers (find, contains, visit) take no lock: they pin an epoch (epoch.hpp) and walk the lists
+ * - Writers (insert, erase) lock one of the stripes, a stripe guards every bucket with the same index modulo
+ *   the number of stripes, so writers to different stripes run in parallel
+ * - A node is never changed after it is linked: overwriting a value links a new node in place of the old one,
+ *   and unlinked nodes are retired to the epoch manager, so a reader never sees a node freed or half written
+ * - Growing locks every stripe, copies the nodes into a new bucket array and publishes it with one pointer store;
+ *   readers already walking the old array finish on it, and it is reclaimed when they have left
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type, must be copy constructible
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ * @tparam SizePolicy   possible numbers of buckets and the map from a hash value to a bucket (hash_prime.hpp)
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>,
+        typename SizePolicy = HashPrime::PrimeSizePolicy
+>
+class ConcurrentHashTable {
+public:
+    typedef std::pair<const Key, Value> HashNode;
+
+protected:
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.5;                      // default maximum load factor is 0.5
+    static constexpr size_t DEFAULT_BUCKET_SIZE = HashPrime::g_a_sizes[0];  // default number of buckets
+    static constexpr size_t DEFAULT_STRIPES = 64;                           // default number of locks
+
+    struct Node {
+        HashNode data;
+        std::atomic<Node *> next;
+
+        Node(const Key &key, const Value &value, Node *next) : data(key, value), next(next) {}
+    };
+
+    /**
+     * A bucket array, owns the nodes linked in it
+     */
+    struct Table {
+        std::unique_ptr<std::atomic<Node *>[]> buckets;
+        size_t bucketSize;
+        SizePolicy sizePolicy;
+
+        explicit Table(size_t bucketSize) : buckets(new std::atomic<Node *>[bucketSize]), bucketSize(bucketSize) {
+            for (size_t i = 0; i < bucketSize; i++) buckets[i].store(nullptr, std::memory_order_relaxed);
+            sizePolicy.setSize(bucketSize);
+        }
+
+        ~Table() {
+            for (size_t i = 0; i < bucketSize; i++) {
+                Node *node = buckets[i].load(std::memory_order_relaxed);
+                while (node) {
+                    Node *next = node->next.load(std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+        }
+
+        std::atomic<Node *> &bucket(size_t hashValue) { return buckets[sizePolicy.index(hashValue)]; }
+    };
+
+    // a lock on its own cache line
+    struct alignas(EpochManager::CACHE_LINE) Stripe {
+        std::mutex mutex;
+    };
+
+    std::atomic<Table *> table;                 // the current bucket array
+    std::vector<Stripe> stripes;                // stripe i locks the buckets whose index is i modulo stripes.size()
+    std::atomic<size_t> tableSize;              // number of elements
+    double maxLoadFactor;                       // maximum load factor
+    Hash hash;                                  // hash function instance
+    KeyEqual keyEqual;                          // key equal function instance
+    mutable EpochManager epoch;                 // reclaims unlinked nodes and old bucket arrays
+
+    /**
+     * Lock the stripe of the bucket of a hash value in the current table
+     * @param current set to the current table, which cannot be replaced until the lock is released
+     */
+    std::unique_lock<std::mutex> lockBucket(size_t hashValue, Table *&current) {
+        while (true) {
+            current = table.load(std::memory_order_acquire);
+            size_t index = current->sizePolicy.index(hashValue);
+            std::unique_lock<std::mutex> lock(stripes[index % stripes.size()].mutex);
+            if (table.load(std::memory_order_relaxed) == current) return lock;
+        }
+    }
+
+    /**
+     * @return the link pointing to the node of key, or to nullptr at the end of the list if key is not found
+     */
+    std::atomic<Node *> *findLink(std::atomic<Node *> &head, const Key &key) const {
+        std::atomic<Node *> *link = &head;
+        Node *node;
+        while ((node = link->load(std::memory_order_acquire)) && !keyEqual(node->data.first, key)) {
+            link = &node->next;
+        }
+        return link;
+    }
+
+    /**
+     * Replace the bucket array by a larger one, unless another writer already did
+     * Time Complexity: O(nk)
+     * @param expected the table whose load factor is exceeded
+     * @param bucketSize lower bound of the new number of buckets
+     */
+    void grow(Table *expected, size_t bucketSize) {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(stripes.size());
+        for (auto &stripe : stripes) locks.emplace_back(stripe.mutex);
+        if (table.load(std::memory_order_relaxed) != expected) return;
+
+        size_t minimum = (size_t) ((double) tableSize.load() / maxLoadFactor) + 1;
+        bucketSize = SizePolicy::nextSize(std::max(bucketSize, minimum));
+        if (bucketSize == expected->bucketSize) return;
+
+        //copy instead of relinking, the readers on the old table need its links unchanged
+        Table *replacement = new Table(bucketSize);
+        for (size_t i = 0; i < expected->bucketSize; i++) {
+            for (Node *node = expected->buckets[i].load(std::memory_order_relaxed); node;
+                 node = node->next.load(std::memory_order_relaxed)) {
+                auto &head = replacement->bucket(hash(node->data.first));
+                head.store(new Node(node->data.first, node->data.second, head.load(std::memory_order_relaxed)),
+                           std::memory_order_relaxed);
+            }
+        }
+        table.store(replacement, std::memory_order_release);
+        epoch.retire(expected);
+    }
+
+public:
+    ConcurrentHashTable() : ConcurrentHashTable(DEFAULT_BUCKET_SIZE) {}
+
+    /**
+     * @param bucketSize lower bound of the number of buckets
+     * @param stripeCount number of locks, the number of writers that can run in parallel
+     */
+    explicit ConcurrentHashTable(size_t bucketSize, size_t stripeCount = DEFAULT_STRIPES) :
+            table(new Table(SizePolicy::nextSize(bucketSize))), stripes(std::max<size_t>(stripeCount, 1)),
+            tableSize(0), maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {}
+
+    ConcurrentHashTable(const ConcurrentHashTable &) = delete;
+
+    ConcurrentHashTable &operator=(const ConcurrentHashTable &) = delete;
+
+    /**
+     * No other thread may use the hashtable any more
+     */
+    ~ConcurrentHashTable() { delete table.load(); }
+
+    /**
+     * Call function with the value of key, while the value cannot be reclaimed
+     * The value may be replaced by a writer at the same time, function sees either the old or the new one
+     * Lock free
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param function called as function(const Value &)
+     * @return whether the key exists in the hashtable
+     */
+    template<typename Function>
+    bool visit(const Key &key, Function function) const {
+        EpochManager::Guard guard(epoch);
+        size_t hashValue = hash(key);
+        Table *current = table.load(std::memory_order_acquire);
+        Node *node = findLink(current->bucket(hashValue), key)->load(std::memory_order_acquire);
+        if (!node) return false;
+        function(static_cast<const Value &>(node->data.second));
+        return true;
+    }
+
+    /**
+     * Copy the value of key
+     * Lock free
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value set to the value of key if it exists
+     * @return whether the key exists in the hashtable
+     */
+    bool find(const Key &key, Value &value) const {
+        return visit(key, [&value](const Value &found) { value = found; });
+    }
+
+    /**
+     * Lock free
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists in the hashtable
+     */
+    bool contains(const Key &key) const {
+        return visit(key, [](const Value &) {});
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, grow the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        //current stays pinned after the lock is released, so another writer cannot free it (or reuse its address)
+        //before the load factor is checked and grow compares it with the current table
+        EpochManager::Guard guard(epoch);
+        size_t hashValue = hash(key);
+        Table *current;
+        {
+            auto lock = lockBucket(hashValue, current);
+            auto &head = current->bucket(hashValue);
+            std::atomic<Node *> *link = findLink(head, key);
+            Node *old = link->load(std::memory_order_relaxed);
+            if (old) {
+                Node *node = new Node(key, value, old->next.load(std::memory_order_relaxed));
+                link->store(node, std::memory_order_release);
+                epoch.retire(old);
+                return false;
+            }
+            head.store(new Node(key, value, head.load(std::memory_order_relaxed)), std::memory_order_release);
+        }
+        size_t size = tableSize.fetch_add(1) + 1;
+        if (maxLoadFactor < (double) size / (double) current->bucketSize) grow(current, current->bucketSize);
+        return true;
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        //lockBucket reads the table before it holds the lock, a concurrent grow may retire it meanwhile
+        EpochManager::Guard guard(epoch);
+        size_t hashValue = hash(key);
+        Table *current;
+        auto lock = lockBucket(hashValue, current);
+        std::atomic<Node *> *link = findLink(current->bucket(hashValue), key);
+        Node *node = link->load(std::memory_order_relaxed);
+        if (!node) return false;
+        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+        tableSize.fetch_sub(1);
+        epoch.retire(node);
+        return true;
+    }
+
+    /**
+     * Grow the hashtable according to the (hinted) number of buckets
+     * It never shrinks, since a smaller table cannot be published without blocking the writers either
+     * Time Complexity: O(nk)
+     * @param bucketSize lower bound of the new number of buckets
+     */
+    void rehash(size_t bucketSize) {
+        EpochManager::Guard guard(epoch);
+        Table *current = table.load(std::memory_order_acquire);
+        if (bucketSize > current->bucketSize) grow(current, bucketSize);
+    }
+
+    /**
+     * @return the number of elements in the hashtable
+     */
+    size_t size() const { return tableSize.load(); }
+
+    /**
+     * @return the number of buckets in the hashtable
+     */
+    size_t bucketSize() const {
+        EpochManager::Guard guard(epoch);
+        return table.load(std::memory_order_acquire)->bucketSize;
+    }
+
+    /**
+     * @return the current load factor of the hashtable
+     */
+    double loadFactor() const { return (double) size() / (double) bucketSize(); }
+
+    /**
+     * @return the maximum load factor of the hashtable
+     */
+    double getMaxLoadFactor() const { return maxLoadFactor; }
+
+    /**
+     * Set the max load factor
+     * Not thread safe, call it before sharing the hashtable
+     * @throw std::range_error if the load factor is too small
+     * @param loadFactor
+     */
+    void setMaxLoadFactor(double loadFactor) {
+        if (loadFactor <= 1e-9) {
+            throw std::range_error("invalid load factor!");
+        }
+        maxLoadFactor = loadFactor;
+        Table *current = table.load();
+        if (this->loadFactor() > maxLoadFactor) grow(current, current->bucketSize);
+    }
+};
+
+#endif //VE281P2_CONCURRENT_HASHTABLE_HPP
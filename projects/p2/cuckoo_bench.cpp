@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "cuckoo_hashtable.hpp"
+#include "hashtable.hpp"
+
+//CuckooHashTable against the chaining HashTable with both filled to a load factor of 0.9
+//Usage: cuckoo_bench [log2 of the number of slots]
+//Each table is sized once, then gets LOAD times its number of slots (cuckoo) or buckets (chaining) of keys,
+//so no insert rehashes; the keys are random, the missing keys are other random keys;
+//the times are nanoseconds per operation
+
+const double LOAD = 0.9;
+const double MAX_LOAD = 0.95;               // above LOAD, so that filling the tables does not grow them
+
+template<typename Function>
+double nanoseconds(size_t ops, Function function){
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count()/(double) ops;
+}
+
+//Insert the first LOAD * bucketSize keys, find them, find as many missing keys, erase half of them, print one line
+template<typename Table>
+void run(const char *name, Table &table, const std::vector<long long> &keys, const std::vector<long long> &missing){
+    size_t n = std::min(keys.size(), (size_t) (LOAD*(double) table.bucketSize()));
+    long long found = 0;
+    double insert = nanoseconds(n, [&](){
+        for (size_t i=0;i<n;i++) table.insert(keys[i], (long long) i);
+    });
+    double load = table.loadFactor();
+    double hit = nanoseconds(n, [&](){
+        for (size_t i=0;i<n;i++) found += table.find(keys[i])->second;
+    });
+    double miss = nanoseconds(n, [&](){
+        for (size_t i=0;i<n;i++) found += table.find(missing[i])==table.end();
+    });
+    double erase = nanoseconds(n/2, [&](){
+        for (size_t i=0;i<n;i+=2) found += table.erase(keys[i]);
+    });
+    std::cout<<name<<"\t"<<n<<"\t"<<load<<"\t"<<insert<<"\t"<<hit<<"\t"<<miss<<"\t"<<erase<<"\n";
+    if (found<0) std::cout<<found;
+}
+
+int main(int argc, char *argv[]){
+    int bits = argc>1 ? std::atoi(argv[1]) : 22;
+    size_t slots = (size_t) 1<<bits, n = 2*slots;          // the chaining table may have more buckets
+    std::mt19937_64 random(281);
+    std::vector<long long> keys(n), missing(n);
+    for (auto &key : keys) key = (long long) random();
+    for (auto &key : missing) key = (long long) random();
+
+    std::cout<<"table\tkeys\tload\tinsert ns\tfind hit ns\tfind miss ns\terase ns\n";
+    {
+        CuckooHashTable<long long, long long> cuckoo(slots);
+        cuckoo.setMaxLoadFactor(MAX_LOAD);
+        run("cuckoo", cuckoo, keys, missing);
+    }
+    {
+        HashTable<long long, long long> chaining;
+        chaining.setMaxLoadFactor(MAX_LOAD);
+        chaining.rehash(slots);
+        run("chaining", chaining, keys, missing);
+    }
+    return 0;
+}
@@ -0,0 +1,596 @@
+#ifndef VE281P2_CUCKOO_HASHTABLE_HPP
+#define VE281P2_CUCKOO_HASHTABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * A bucketized cuckoo hashtable with the same interface as HashTable (hashtable.hpp)
+ * The slots are split into buckets of SLOTS, and every key can only be in two buckets, so a lookup reads
+ * two buckets at most, whatever the load factor
+ * Every slot has a one byte tag, 0 if empty, or 8 bits of the hash of its key; one SSE2 compare of the
+ * tags of a bucket picks the slots whose keys are compared
+ * The second bucket of a key is its first bucket xor a hash of its tag, so an element is moved to its other bucket
+ * without hashing its key again
+ * When both buckets of a new key are full, a breadth first search finds the shortest chain of elements to move,
+ * each into its other bucket, that ends at a free slot; if there is none the hashtable grows, unless it is less
+ * than half full: then the buckets are crowded by keys with the same hashes, which no size separates, and the
+ * element goes to the stash, a list of at most MAX_STASH elements searched by every lookup that misses both
+ * buckets; an insert that would overflow it throws, like RobinHoodHashTable past MAX_PROBE_LIMIT
+ * (a rehash puts the elements of the stash back first, and keeps any that still fit nowhere, even past MAX_STASH)
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>
+>
+class CuckooHashTable {
+public:
+    typedef std::pair<const Key, Value> HashNode;
+
+protected:
+    typedef uint8_t Tag;
+    static constexpr Tag EMPTY = 0;
+    static constexpr size_t SLOTS = 8;                  // slots per bucket
+    static constexpr size_t MAX_SEARCH = 512;           // buckets visited by the search for a free slot
+    static constexpr double MIN_GROW_LOAD = 0.5;        // below this load factor a failed insert goes to the stash
+    static constexpr size_t MAX_STASH = 8;              // elements an insert may put into the stash
+    static constexpr size_t NO_SLOT = SIZE_MAX;         // no free slot for a key in its buckets
+
+    /**
+     * A bit mask of the slots in a bucket whose tag matches
+     */
+    static uint32_t match(const Tag *tags, Tag tag) {
+#ifdef __SSE2__
+        __m128i bucket = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(tags));
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(bucket, _mm_set1_epi8((char) tag))) & 0xffu;
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < SLOTS; i++) mask |= uint32_t(tags[i] == tag) << i;
+        return mask;
+#endif
+    }
+
+    static int lowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+
+public:
+    /**
+     * A single directional iterator for the hashtable
+     */
+    class Iterator {
+    private:
+        const CuckooHashTable *hashTable;
+        size_t index;               // slot index, slotCount + i for the element i of the stash, or for an iterator
+                                    // returned by a failed find, a free slot for the key, or NO_SLOT if there is none
+        bool endFlag = false;       // whether it is an end iterator
+
+        /**
+         * Increment the iterator to the next full slot
+         * Time complexity: Amortized O(1)
+         */
+        void increment() {
+            while (++index < hashTable->slotCount) {
+                if (hashTable->tags[index] != EMPTY) return;
+            }
+            if (index - hashTable->slotCount < hashTable->stash.size()) return;
+            endFlag = true;
+        }
+
+        Iterator(const CuckooHashTable *hashTable, size_t index, bool endFlag) :
+                hashTable(hashTable), index(index), endFlag(endFlag) {}
+
+    public:
+        friend class CuckooHashTable;
+
+        Iterator() = delete;
+
+        Iterator(const Iterator &) = default;
+
+        Iterator &operator=(const Iterator &) = default;
+
+        Iterator &operator++() {
+            increment();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            increment();
+            return temp;
+        }
+
+        bool operator==(const Iterator &that) const {
+            if (endFlag && that.endFlag) return true;
+            return endFlag == that.endFlag && index == that.index;
+        }
+
+        bool operator!=(const Iterator &that) const {
+            return !(*this == that);
+        }
+
+        HashNode *operator->() {
+            return hashTable->node(index);
+        }
+
+        HashNode &operator*() {
+            return *hashTable->node(index);
+        }
+    };
+
+protected:
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.9;                      // default maximum load factor is 0.9
+    static constexpr size_t DEFAULT_BUCKET_SIZE = 2 * SLOTS;                // default number of slots is two buckets
+
+    Tag *tags = nullptr;                        // one tag per slot
+    HashNode *slots = nullptr;                  // uninitialized storage, only slots with a tag hold a node
+    std::vector<HashNode *> stash;              // elements that fit in neither of their buckets
+    size_t slotCount = 0;                       // number of slots, a power of 2 and a multiple of SLOTS
+    size_t tableSize = 0;                       // number of elements
+    double maxLoadFactor;                       // maximum load factor
+    Hash hash;                                  // hash function instance
+    KeyEqual keyEqual;                          // key equal function instance
+
+    /**
+     * Spread the bits of the hash, std::hash is the identity for integers
+     */
+    static size_t mix(size_t h) {
+        uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return (size_t) x;
+    }
+
+    static Tag tagOf(size_t h) {
+        Tag tag = (Tag) (h >> 56);
+        return tag == EMPTY ? 1 : tag;
+    }
+
+    size_t bucketMask() const { return slotCount / SLOTS - 1; }
+
+    size_t firstBucket(size_t h) const { return h & bucketMask(); }
+
+    /**
+     * The other bucket of an element with the tag in the bucket, the map is its own inverse
+     * The xor only depends on the tag, and is never 0, so the two buckets always differ
+     */
+    size_t otherBucket(size_t bucket, Tag tag) const {
+        size_t delta = ((size_t) tag * 0x5bd1e995u) & bucketMask();
+        return bucket ^ (delta ? delta : 1);
+    }
+
+    HashNode *node(size_t index) const {
+        return index < slotCount ? slots + index : stash[index - slotCount];
+    }
+
+    /**
+     * @return the index of a free slot in the bucket, or slotCount if it is full
+     */
+    size_t freeSlot(size_t bucket) const {
+        uint32_t mask = match(tags + bucket * SLOTS, EMPTY);
+        return mask ? bucket * SLOTS + lowestBit(mask) : slotCount;
+    }
+
+    void moveSlot(size_t from, size_t to) {
+        new(slots + to) HashNode(std::move(slots[from]));
+        slots[from].~HashNode();
+        tags[to] = tags[from];
+        tags[from] = EMPTY;
+    }
+
+    /**
+     * Make a slot free in one of two full buckets, by moving a chain of elements each into its other bucket
+     * The buckets are searched breadth first, so the chain is the shortest one
+     * Time complexity: O(MAX_SEARCH)
+     * @return the index of the free slot, or slotCount if no chain is found within MAX_SEARCH buckets
+     */
+    size_t makeRoom(size_t first, size_t second) {
+        struct Visit {
+            size_t bucket;
+            size_t parent;      // the visit of the bucket that the element comes from
+            size_t slot;        // the slot of that element in the parent bucket
+        };
+        const size_t ROOT = SIZE_MAX;
+        std::vector<Visit> queue;
+        queue.reserve(MAX_SEARCH);
+        queue.push_back({first, ROOT, 0});
+        queue.push_back({second, ROOT, 0});
+        for (size_t head = 0; head < queue.size(); head++) {
+            size_t free = freeSlot(queue[head].bucket);
+            if (free != slotCount && distinctPath(queue, head)) {
+                //move the elements from the end of the chain back to the start
+                size_t current = head;
+                while (queue[current].parent != ROOT) {
+                    const Visit &parent = queue[queue[current].parent];
+                    size_t from = parent.bucket * SLOTS + queue[current].slot;
+                    moveSlot(from, free);
+                    free = from;
+                    current = queue[current].parent;
+                }
+                return free;
+            }
+            if (queue.size() + SLOTS > MAX_SEARCH) continue;
+            for (size_t s = 0; s < SLOTS; s++) {
+                size_t bucket = queue[head].bucket;
+                queue.push_back({otherBucket(bucket, tags[bucket * SLOTS + s]), head, s});
+            }
+        }
+        return slotCount;
+    }
+
+    /**
+     * A chain through the same bucket twice could move an element that an earlier move has just placed
+     */
+    template<typename Visits>
+    static bool distinctPath(const Visits &queue, size_t node) {
+        for (size_t i = node; i != SIZE_MAX; i = queue[i].parent) {
+            for (size_t j = queue[i].parent; j != SIZE_MAX; j = queue[j].parent) {
+                if (queue[i].bucket == queue[j].bucket) return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Put a node whose key is not in the hashtable into one of its buckets
+     * @param carried the node to put, empty after success
+     * @return false if there is no room, then the hashtable is unchanged except for moved elements
+     */
+    bool place(std::optional<HashNode> &carried) {
+        size_t h = mix(hash(carried->first));
+        size_t first = firstBucket(h);
+        size_t second = otherBucket(first, tagOf(h));
+        size_t index = freeSlot(first);
+        if (index == slotCount) index = freeSlot(second);
+        if (index == slotCount) index = makeRoom(first, second);
+        if (index == slotCount) return false;
+        new(slots + index) HashNode(std::move(*carried));
+        carried.reset();
+        tags[index] = tagOf(h);
+        return true;
+    }
+
+    /**
+     * Put a node whose key is not in the hashtable, growing the hashtable until it fits,
+     * or into the stash if the hashtable is less than half full
+     * Every growth at least halves a load factor of at least MIN_GROW_LOAD, so this ends
+     * @throw std::range_error if the stash already holds stashLimit elements,
+     * then carried still holds the node and the hashtable is valid
+     */
+    void reinsert(std::optional<HashNode> &carried, size_t stashLimit = SIZE_MAX) {
+        while (!place(carried)) {
+            if (loadFactor() < MIN_GROW_LOAD) {
+                if (stash.size() >= stashLimit) throw std::range_error("too many keys with the same hash value!");
+                stash.push_back(new HashNode(std::move(*carried)));
+                carried.reset();
+                return;
+            }
+            rehash(slotCount * 2);
+        }
+    }
+
+    void clearStash() {
+        for (HashNode *p : stash) delete p;
+        stash.clear();
+    }
+
+    void allocate(size_t newSlotCount) {
+        slotCount = newSlotCount;
+        tags = new Tag[slotCount]();
+        slots = std::allocator<HashNode>().allocate(slotCount);
+    }
+
+    void deallocate() {
+        if (!tags) return;
+        for (size_t i = 0; i < slotCount; i++) {
+            if (tags[i] != EMPTY) slots[i].~HashNode();
+        }
+        std::allocator<HashNode>().deallocate(slots, slotCount);
+        delete[] tags;
+        tags = nullptr;
+        slots = nullptr;
+        slotCount = 0;
+    }
+
+    /**
+     * Find the minimum number of slots for the hashtable
+     * The minimum bucket size must satisfy all of the following requirements:
+     * - It is not less than (i.e. greater or equal to) the parameter bucketSize
+     * - It is greater than floor(tableSize / maxLoadFactor)
+     * - It is a power of 2 and at least two buckets
+     * Time Complexity: O(1)
+     * @throw std::range_error if no such bucket size can be found
+     * @param bucketSize lower bound of the new number of slots
+     */
+    size_t findMinimumBucketSize(size_t bucketSize) const {
+        size_t lower = std::max(bucketSize, (size_t) ((double) tableSize / maxLoadFactor) + 1);
+        size_t result = DEFAULT_BUCKET_SIZE;
+        while (result < lower) {
+            if (result > (SIZE_MAX >> 1)) throw std::range_error("Out of Range");
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void copyFrom(const CuckooHashTable &that) {
+        allocate(that.slotCount);
+        for (size_t i = 0; i < slotCount; i++) {
+            tags[i] = that.tags[i];
+            if (tags[i] != EMPTY) new(slots + i) HashNode(that.slots[i]);
+        }
+        for (HashNode *p : that.stash) stash.push_back(new HashNode(*p));
+        tableSize = that.tableSize;
+    }
+
+public:
+    CuckooHashTable() :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(DEFAULT_BUCKET_SIZE);
+    }
+
+    explicit CuckooHashTable(size_t bucketSize) :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(findMinimumBucketSize(bucketSize));
+    }
+
+    CuckooHashTable(const CuckooHashTable &that) :
+            maxLoadFactor(that.maxLoadFactor), hash(that.hash), keyEqual(that.keyEqual) {
+        copyFrom(that);
+    }
+
+    CuckooHashTable &operator=(const CuckooHashTable &that) {
+        if (this == &that) return *this;
+        deallocate();
+        clearStash();
+        maxLoadFactor = that.maxLoadFactor;
+        hash = that.hash;
+        keyEqual = that.keyEqual;
+        copyFrom(that);
+        return *this;
+    }
+
+    ~CuckooHashTable() {
+        deallocate();
+        clearStash();
+    }
+
+    Iterator begin() {
+        Iterator it(this, 0, false);
+        if (tags[0] == EMPTY) it.increment();
+        return it;
+    }
+
+    Iterator end() {
+        return Iterator(this, slotCount, true);
+    }
+
+    /**
+     * Find whether the key exists in the hashtable
+     * Time Complexity: O(k)
+     * @param key
+     * @return whether the key exists in the hashtable
+     */
+    bool contains(const Key &key) {
+        return find(key) != end();
+    }
+
+    /**
+     * Find the value in hashtable by key
+     * If the key exists, iterator points to the corresponding value, and it.endFlag = false
+     * Otherwise, iterator points to a free slot for the key (NO_SLOT if there is none), and it.endFlag = true
+     * Time Complexity: O(k), at most two buckets are read, and the stash if it is not empty (MAX_STASH elements,
+     * unless a rehash left more there)
+     * @param key
+     * @return an iterator of the value
+     */
+    Iterator find(const Key &key) {
+        size_t h = mix(hash(key));
+        Tag tag = tagOf(h);
+        size_t buckets[2] = {firstBucket(h), 0};
+        buckets[1] = otherBucket(buckets[0], tag);
+        for (size_t bucket : buckets) {
+            for (uint32_t mask = match(tags + bucket * SLOTS, tag); mask; mask &= mask - 1) {
+                size_t index = bucket * SLOTS + lowestBit(mask);
+                if (keyEqual(slots[index].first, key)) return Iterator(this, index, false);
+            }
+        }
+        for (size_t i = 0; i < stash.size(); i++) {
+            if (keyEqual(stash[i]->first, key)) return Iterator(this, slotCount + i, false);
+        }
+        size_t index = freeSlot(buckets[0]);
+        if (index == slotCount) index = freeSlot(buckets[1]);
+        return Iterator(this, index != slotCount ? index : NO_SLOT, true);
+    }
+
+    /**
+     * Insert value into the hashtable according to an iterator returned by find
+     * the function can be only be called if no other write actions are done to the hashtable after the find
+     * If the key already exists, overwrite its value
+     * If both buckets of the key are full, elements are moved to make room, or the hashtable grows,
+     * or the element goes to the stash
+     * @throw std::range_error if the element must go to the stash and it is full (too many keys with the
+     * same hash value), then the key is not inserted and the hashtable is valid
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: O(k), or O(k * MAX_SEARCH) if elements are moved
+     * @param it an iterator returned by find
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Iterator &it, const Key &key, const Value &value) {
+        if (!it.endFlag) {
+            node(it.index)->second = value;
+            return false;
+        }
+        if (it.index != NO_SLOT) {
+            new(slots + it.index) HashNode(key, value);
+            tags[it.index] = tagOf(mix(hash(key)));
+        }
+        else {
+            std::optional<HashNode> carried;
+            carried.emplace(key, value);
+            reinsert(carried, MAX_STASH);
+        }
+        ++tableSize;
+        if ((double) tableSize > maxLoadFactor * (double) slotCount) rehash(slotCount);
+        return true;
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @throw std::range_error if too many keys have the same hash value as key, see insert(it, key, value)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        return insert(find(key), key, value);
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * DO NOT rehash in this function
+     * Time Complexity: O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) return false;
+        erase(it);
+        return true;
+    }
+
+    /**
+     * Erase the key at the input iterator
+     * If the input iterator is the end iterator, do nothing and return the input iterator directly
+     * Time Complexity: O(1)
+     * @param it
+     * @return the iterator after the input iterator before the erase
+     */
+    Iterator erase(const Iterator &it) {
+        if (it.endFlag) return it;
+        --tableSize;
+        if (it.index >= slotCount) {
+            //the last element of the stash takes the place of the erased one
+            size_t i = it.index - slotCount;
+            delete stash[i];
+            stash[i] = stash.back();
+            stash.pop_back();
+            return i < stash.size() ? it : end();
+        }
+        slots[it.index].~HashNode();
+        tags[it.index] = EMPTY;
+        Iterator next = it;
+        next.increment();
+        return next;
+    }
+
+    /**
+     * Get the reference of value by key in the hashtable
+     * If the key doesn't exist, create it first (use default constructor of Value)
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return reference of value
+     */
+    Value &operator[](const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) {
+            insert(it, key, Value());
+            it = find(key);
+        }
+        return it->second;
+    }
+
+    /**
+     * Rehash the hashtable according to the (hinted) number of slots
+     * The number of slots after rehash need not be same as the parameter bucketSize
+     * Instead, findMinimumBucketSize is called to get the correct number
+     * Do nothing if the number of slots doesn't change
+     * Time Complexity: O(nk)
+     * @param bucketSize lower bound of the new number of slots
+     */
+    void rehash(size_t bucketSize) {
+        bucketSize = findMinimumBucketSize(bucketSize);
+        if (bucketSize == slotCount) return;
+
+        Tag *oldTags = tags;
+        HashNode *oldSlots = slots;
+        size_t oldSlotCount = slotCount;
+        std::vector<HashNode *> oldStash;
+        oldStash.swap(stash);
+        allocate(bucketSize);
+        std::optional<HashNode> carried;
+        for (size_t i = 0; i < oldSlotCount; i++) {
+            if (oldTags[i] == EMPTY) continue;
+            carried.emplace(std::move(oldSlots[i]));
+            oldSlots[i].~HashNode();
+            reinsert(carried);
+        }
+        std::allocator<HashNode>().deallocate(oldSlots, oldSlotCount);
+        delete[] oldTags;
+        //the elements of the stash get another chance in the new buckets
+        for (HashNode *p : oldStash) {
+            carried.emplace(std::move(*p));
+            delete p;
+            reinsert(carried);
+        }
+    }
+
+    /**
+     * @return the number of elements in the hashtable
+     */
+    size_t size() const { return tableSize; }
+
+    /**
+     * @return the number of slots in the hashtable
+     */
+    size_t bucketSize() const { return slotCount; }
+
+    /**
+     * @return the current load factor of the hashtable
+     */
+    double loadFactor() const { return (double) tableSize / (double) slotCount; }
+
+    /**
+     * @return the maximum load factor of the hashtable
+     */
+    double getMaxLoadFactor() const { return maxLoadFactor; }
+
+    /**
+     * Set the max load factor
+     * @throw std::range_error if the load factor is too small or too large
+     * @param loadFactor
+     */
+    void setMaxLoadFactor(double loadFactor) {
+        if (loadFactor <= 1e-9 || loadFactor > 0.98) {
+            throw std::range_error("invalid load factor!");
+        }
+        maxLoadFactor = loadFactor;
+        rehash(slotCount);
+    }
+};
+
+#endif //VE281P2_CUCKOO_HASHTABLE_HPP
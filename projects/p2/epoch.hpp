@@ -0,0 +1,304 @@
+#ifndef VE281P2_EPOCH_HPP
+#define VE281P2_EPOCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Epoch-based reclamation for structures that are read without locks
+ * A reader pins the current epoch (with a Guard) while it holds pointers into the structure
+ * A writer that unlinks an object retires it instead of deleting it,
+ * and the object is deleted once every reader that pinned an epoch before the unlink has left
+ * Every reading thread uses one of MAX_THREADS slots, claimed on its first read and released when the thread exits,
+ * so a Guard costs one store and one fence, with no shared cache line written
+ */
+class EpochManager {
+public:
+    static constexpr size_t MAX_THREADS = 256;              // maximum number of threads reading at the same time
+    static constexpr size_t CACHE_LINE = 64;
+
+protected:
+    static constexpr uint64_t QUIESCENT = 0;                // epoch of a slot outside any read
+    static constexpr size_t RECLAIM_THRESHOLD = 64;         // minimum number of retired objects to trigger a reclaim
+
+    // one per thread, on its own cache line
+    struct alignas(CACHE_LINE) Slot {
+        std::atomic<uint64_t> epoch{QUIESCENT};             // the epoch pinned by the thread
+        size_t depth = 0;                                   // number of nested guards, only used by the thread
+    };
+
+    struct Retired {
+        uint64_t epoch;                                     // the epoch when the object is unlinked
+        void *object;
+        void (*deleter)(void *);
+    };
+
+    /**
+     * The slot index of a thread is shared by every EpochManager
+     */
+    class ThreadSlot {
+        static std::atomic<bool> *owners() {
+            static std::atomic<bool> owned[MAX_THREADS];
+            return owned;
+        }
+
+    public:
+        size_t index;
+
+        /**
+         * @throw std::runtime_error if more than MAX_THREADS threads read at the same time
+         */
+        ThreadSlot() {
+            for (index = 0; index < MAX_THREADS; index++) {
+                bool expected = false;
+                if (owners()[index].compare_exchange_strong(expected, true)) return;
+            }
+            throw std::runtime_error("too many threads!");
+        }
+
+        ~ThreadSlot() { owners()[index].store(false); }
+    };
+
+    static size_t threadIndex() {
+        thread_local ThreadSlot slot;
+        return slot.index;
+    }
+
+    std::atomic<uint64_t> globalEpoch{1};
+    Slot slots[MAX_THREADS];
+
+    std::mutex retiredMutex;
+    std::vector<Retired> retired;
+    size_t reclaimAt = RECLAIM_THRESHOLD;                   // doubles while long readers keep objects alive
+
+    /**
+     * @return the smallest epoch pinned by a reader, or the maximum value if there is no reader
+     */
+    uint64_t minimumPinned() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t minimum = std::numeric_limits<uint64_t>::max();
+        for (const Slot &slot : slots) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+            if (epoch != QUIESCENT) minimum = std::min(minimum, epoch);
+        }
+        return minimum;
+    }
+
+    /**
+     * Take the retired objects that no reader can see out of retired, to be deleted without the lock
+     */
+    std::vector<Retired> collect() {
+        uint64_t minimum = minimumPinned();
+        auto it = std::partition(retired.begin(), retired.end(),
+                                 [minimum](const Retired &r) { return r.epoch >= minimum; });
+        std::vector<Retired> expired(std::make_move_iterator(it), std::make_move_iterator(retired.end()));
+        retired.erase(it, retired.end());
+        reclaimAt = std::max(RECLAIM_THRESHOLD, 2 * retired.size());
+        return expired;
+    }
+
+    static void destroy(const std::vector<Retired> &expired) {
+        for (const Retired &r : expired) r.deleter(r.object);
+    }
+
+public:
+    /**
+     * Pin the current epoch while it is alive
+     * Guards can be nested, only the outermost one pins
+     */
+    class Guard {
+        Slot &slot;
+
+    public:
+        explicit Guard(EpochManager &manager) : slot(manager.slots[threadIndex()]) {
+            if (slot.depth++ == 0) {
+                slot.epoch.store(manager.globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                //the pin must be visible before any pointer of the structure is read
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        Guard(const Guard &) = delete;
+
+        Guard &operator=(const Guard &) = delete;
+
+        ~Guard() {
+            if (--slot.depth == 0) slot.epoch.store(QUIESCENT, std::memory_order_release);
+        }
+    };
+
+    EpochManager() = default;
+
+    EpochManager(const EpochManager &) = delete;
+
+    EpochManager &operator=(const EpochManager &) = delete;
+
+    /**
+     * No reader may be left, every retired object is deleted
+     */
+    ~EpochManager() { destroy(retired); }
+
+    /**
+     * Retire an object that is already unlinked, it is deleted when no reader can see it
+     * Time Complexity: Amortized O(1)
+     * @param object allocated by new
+     */
+    template<typename T>
+    void retire(T *object) {
+        retire(object, [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    void retire(void *object, void (*deleter)(void *)) {
+        //readers pinning a later epoch start after the unlink, so they cannot see the object
+        uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        std::vector<Retired> expired;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            retired.push_back({epoch, object, deleter});
+            if (retired.size() >= reclaimAt) expired = collect();
+        }
+        destroy(expired);
+    }
+
+    /**
+     * Delete every retired object that no reader can see
+     * Time Complexity: O(MAX_THREADS + number of retired objects)
+     */
+    void reclaim() {
+        std::vector<Retired> expired;
+        {
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            expired = collect();
+        }
+        destroy(expired);
+    }
+
+    /**
+     * Block until every reader that pinned an epoch before the call has left, then reclaim
+     * Must not be called inside a Guard
+     */
+    void synchronize() {
+        uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        while (minimumPinned() <= epoch) std::this_thread::yield();
+        reclaim();
+    }
+};
+
+/**
+ * Quiescent-state-based reclamation, for readers that can name points where they hold no pointer
+ * Each reading thread registers a Reader, and calls quiescent between operations, e.g. once per batch of
+ * lookups; the reads themselves write nothing and need no fence
+ * A writer calls advance after it unlinks objects, and may delete them once passed says every online reader
+ * has been quiescent since; a Reader that waits or sleeps for a while goes offline, so that it holds no one back
+ */
+class QuiescentStateManager {
+public:
+    static constexpr size_t MAX_READERS = 256;              // maximum number of registered readers
+    static constexpr size_t CACHE_LINE = 64;
+
+protected:
+    static constexpr uint64_t OFFLINE = 0;                  // version of a slot whose reader holds no pointer
+
+    // one per reader, on its own cache line
+    struct alignas(CACHE_LINE) Slot {
+        std::atomic<uint64_t> seen{OFFLINE};                // the version at the last quiescent point
+        std::atomic<bool> owned{false};
+    };
+
+    std::atomic<uint64_t> globalVersion{1};
+    Slot slots[MAX_READERS];
+
+public:
+    /**
+     * A registered reader, online while it is alive unless it calls offline
+     * Only used by the thread that created it
+     */
+    class Reader {
+        QuiescentStateManager &manager;
+        Slot *slot = nullptr;
+
+    public:
+        /**
+         * @throw std::runtime_error if MAX_READERS readers are registered
+         */
+        explicit Reader(QuiescentStateManager &manager) : manager(manager) {
+            for (Slot &candidate : manager.slots) {
+                bool expected = false;
+                if (candidate.owned.compare_exchange_strong(expected, true)) {
+                    slot = &candidate;
+                    online();
+                    return;
+                }
+            }
+            throw std::runtime_error("too many readers!");
+        }
+
+        Reader(const Reader &) = delete;
+
+        Reader &operator=(const Reader &) = delete;
+
+        ~Reader() {
+            offline();
+            slot->owned.store(false, std::memory_order_release);
+        }
+
+        /**
+         * Announce that the reader holds no pointer read before the call
+         * Time Complexity: O(1), one load and one store
+         */
+        void quiescent() {
+            slot->seen.store(manager.globalVersion.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        /**
+         * Hold no pointer until online is called
+         */
+        void offline() { slot->seen.store(OFFLINE, std::memory_order_release); }
+
+        void online() {
+            slot->seen.store(manager.globalVersion.load(std::memory_order_acquire), std::memory_order_relaxed);
+            //being online must be visible before any pointer of the structure is read
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    };
+
+    QuiescentStateManager() = default;
+
+    QuiescentStateManager(const QuiescentStateManager &) = delete;
+
+    QuiescentStateManager &operator=(const QuiescentStateManager &) = delete;
+
+    /**
+     * Start a grace period, after objects are unlinked
+     * @return the version to give to passed
+     */
+    uint64_t advance() { return globalVersion.fetch_add(1, std::memory_order_seq_cst); }
+
+    /**
+     * @return the smallest version seen by an online reader, or the maximum value if there is none
+     */
+    uint64_t minimumSeen() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t minimum = std::numeric_limits<uint64_t>::max();
+        for (const Slot &slot : slots) {
+            uint64_t seen = slot.seen.load(std::memory_order_acquire);
+            if (seen != OFFLINE) minimum = std::min(minimum, seen);
+        }
+        return minimum;
+    }
+
+    /**
+     * Whether every online reader has been quiescent since advance returned version
+     * Time Complexity: O(MAX_READERS)
+     */
+    bool passed(uint64_t version) const { return minimumSeen() > version; }
+};
+
+#endif //VE281P2_EPOCH_HPP
@@ -0,0 +1,633 @@
+#ifndef VE281P2_FLAT_HASHTABLE_HPP
+#define VE281P2_FLAT_HASHTABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//the slots of FlatHashTable as one array of pairs
+template<typename Key, typename Value, bool Split>
+struct FlatSlots {
+    typedef std::pair<const Key, Value> HashNode;
+    typedef HashNode &Reference;
+    typedef HashNode *Pointer;
+
+    HashNode *nodes = nullptr;
+
+    void allocate(size_t n) { nodes = std::allocator<HashNode>().allocate(n); }
+
+    void deallocate(size_t n) { std::allocator<HashNode>().deallocate(nodes, n); }
+
+    const Key &key(size_t i) const { return nodes[i].first; }
+
+    Value &value(size_t i) const { return nodes[i].second; }
+
+    Reference at(size_t i) const { return nodes[i]; }
+
+    Pointer pointer(size_t i) const { return nodes + i; }
+
+    void construct(size_t i, const Key &key, const Value &value) { new(nodes + i) HashNode(key, value); }
+
+    void copy(size_t i, const FlatSlots &that, size_t j) { new(nodes + i) HashNode(that.nodes[j]); }
+
+    void move(size_t i, FlatSlots &that, size_t j) {
+        new(nodes + i) HashNode(std::move(that.nodes[j]));
+        that.nodes[j].~HashNode();
+    }
+
+    void destroy(size_t i) { nodes[i].~HashNode(); }
+
+    void prefetch(size_t i) const { __builtin_prefetch(nodes + i); }
+};
+
+//or as an array of keys and an array of values, a probe only reads the keys
+template<typename Key, typename Value>
+struct FlatSlots<Key, Value, true> {
+    typedef std::pair<const Key &, Value &> Reference;
+
+    // what operator-> returns, it->first and it->second refer to the arrays
+    struct Pointer {
+        Reference reference;
+
+        Reference *operator->() { return &reference; }
+    };
+
+    Key *keys = nullptr;
+    Value *values = nullptr;
+
+    void allocate(size_t n) {
+        keys = std::allocator<Key>().allocate(n);
+        values = std::allocator<Value>().allocate(n);
+    }
+
+    void deallocate(size_t n) {
+        std::allocator<Key>().deallocate(keys, n);
+        std::allocator<Value>().deallocate(values, n);
+    }
+
+    const Key &key(size_t i) const { return keys[i]; }
+
+    Value &value(size_t i) const { return values[i]; }
+
+    Reference at(size_t i) const { return Reference(keys[i], values[i]); }
+
+    Pointer pointer(size_t i) const { return Pointer{at(i)}; }
+
+    void construct(size_t i, const Key &key, const Value &value) {
+        new(keys + i) Key(key);
+        new(values + i) Value(value);
+    }
+
+    void copy(size_t i, const FlatSlots &that, size_t j) { construct(i, that.keys[j], that.values[j]); }
+
+    void move(size_t i, FlatSlots &that, size_t j) {
+        new(keys + i) Key(std::move(that.keys[j]));
+        new(values + i) Value(std::move(that.values[j]));
+        that.destroy(j);
+    }
+
+    void destroy(size_t i) {
+        keys[i].~Key();
+        values[i].~Value();
+    }
+
+    void prefetch(size_t i) const { __builtin_prefetch(keys + i); }
+};
+
+/**
+ * An open-addressing hashtable with the same interface as HashTable (hashtable.hpp)
+ * The slots are split into groups of 16, and every slot has one control byte:
+ * EMPTY, DELETED, or the low 7 bits of the hash (h2) of the key stored in it
+ * A lookup probes whole groups: one SSE2 compare of the 16 control bytes with h2 picks the candidate slots,
+ * so the keys are only compared when their h2 match, and the probe stops at the first group with an EMPTY slot
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ * @tparam SplitStorage whether keys and values are kept in two arrays instead of one array of pairs,
+ *                      then a probe only brings keys into the cache (good for large values);
+ *                      the iterator gives a pair of references, it->first and it->second work the same
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>,
+        bool SplitStorage = false
+>
+class FlatHashTable {
+public:
+    typedef std::pair<const Key, Value> HashNode;
+    typedef FlatSlots<Key, Value, SplitStorage> Slots;
+
+protected:
+    typedef int8_t Control;
+    static constexpr Control EMPTY = -128;      // never used, ends a probe
+    static constexpr Control DELETED = -2;      // erased, a probe goes on
+    static constexpr size_t GROUP_SIZE = 16;
+    static constexpr size_t BATCH = 16;         // keys hashed and prefetched together
+
+    /**
+     * A bit mask of the slots in a group whose control byte matches
+     */
+    struct Group {
+        const Control *control;
+
+        explicit Group(const Control *control) : control(control) {}
+
+        uint32_t match(Control h2) const {
+#ifdef __SSE2__
+            __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(control));
+            return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; i++) mask |= uint32_t(control[i] == h2) << i;
+            return mask;
+#endif
+        }
+
+        uint32_t matchEmpty() const { return match(EMPTY); }
+
+        uint32_t matchEmptyOrDeleted() const {
+#ifdef __SSE2__
+            // both EMPTY and DELETED are negative, full slots hold h2 in [0, 127]
+            __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(control));
+            return (uint32_t) _mm_movemask_epi8(group);
+#else
+            uint32_t mask = 0;
+            for (size_t i = 0; i < GROUP_SIZE; i++) mask |= uint32_t(control[i] < 0) << i;
+            return mask;
+#endif
+        }
+    };
+
+    static int lowestBit(uint32_t mask) { return __builtin_ctz(mask); }
+
+public:
+    /**
+     * A single directional iterator for the hashtable
+     */
+    class Iterator {
+    private:
+        const FlatHashTable *hashTable;
+        size_t index;               // slot index, or the slot to insert into for an iterator returned by a failed find
+        bool endFlag = false;       // whether it is an end iterator
+
+        /**
+         * Increment the iterator to the next full slot
+         * Time complexity: Amortized O(1)
+         */
+        void increment() {
+            while (++index < hashTable->capacity) {
+                if (hashTable->control[index] >= 0) return;
+            }
+            endFlag = true;
+        }
+
+        Iterator(const FlatHashTable *hashTable, size_t index, bool endFlag) :
+                hashTable(hashTable), index(index), endFlag(endFlag) {}
+
+    public:
+        friend class FlatHashTable;
+
+        Iterator() = delete;
+
+        Iterator(const Iterator &) = default;
+
+        Iterator &operator=(const Iterator &) = default;
+
+        Iterator &operator++() {
+            increment();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            increment();
+            return temp;
+        }
+
+        bool operator==(const Iterator &that) const {
+            if (endFlag && that.endFlag) return true;
+            return endFlag == that.endFlag && index == that.index;
+        }
+
+        bool operator!=(const Iterator &that) const {
+            return !(*this == that);
+        }
+
+        typename Slots::Pointer operator->() {
+            return hashTable->slots.pointer(index);
+        }
+
+        typename Slots::Reference operator*() {
+            return hashTable->slots.at(index);
+        }
+    };
+
+protected:
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.875;                    // default maximum load factor is 7/8
+    static constexpr size_t DEFAULT_BUCKET_SIZE = GROUP_SIZE;               // default number of slots is one group
+
+    Control *control = nullptr;                 // one control byte per slot
+    Slots slots;                                // uninitialized storage, only full slots hold a node
+    size_t capacity = 0;                        // number of slots, a power of 2 and a multiple of GROUP_SIZE
+    size_t tableSize = 0;                       // number of elements
+    size_t deletedSize = 0;                     // number of DELETED slots
+    double maxLoadFactor;                       // maximum load factor, counting DELETED slots
+    Hash hash;                                  // hash function instance
+    KeyEqual keyEqual;                          // key equal function instance
+
+    /**
+     * Spread the bits of the hash, std::hash is the identity for integers
+     */
+    static size_t mix(size_t h) {
+        uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return (size_t) x;
+    }
+
+    static Control h2(size_t h) { return (Control) (h & 0x7f); }
+
+    size_t groupMask() const { return capacity / GROUP_SIZE - 1; }
+
+    /**
+     * Find the first EMPTY or DELETED slot in the probe sequence of h
+     * Time complexity: Amortized O(1)
+     */
+    size_t findFreeSlot(size_t h) const {
+        size_t group = (h >> 7) & groupMask();
+        for (size_t step = 1;; step++) {
+            uint32_t free = Group(control + group * GROUP_SIZE).matchEmptyOrDeleted();
+            if (free) return group * GROUP_SIZE + lowestBit(free);
+            group = (group + step) & groupMask();
+        }
+    }
+
+    void setControl(size_t index, Control c) { control[index] = c; }
+
+    /**
+     * Find the key, whose mixed hash is h
+     * Time Complexity: Amortized O(k)
+     */
+    Iterator findHashed(const Key &key, size_t h) {
+        Control tag = h2(h);
+        size_t group = (h >> 7) & groupMask();
+        for (size_t step = 1;; step++) {
+            Group g(control + group * GROUP_SIZE);
+            for (uint32_t mask = g.match(tag); mask; mask &= mask - 1) {
+                size_t index = group * GROUP_SIZE + lowestBit(mask);
+                if (keyEqual(slots.key(index), key)) return Iterator(this, index, false);
+            }
+            if (g.matchEmpty()) return Iterator(this, findFreeSlot(h), true);
+            group = (group + step) & groupMask();
+        }
+    }
+
+    /**
+     * insert with the mixed hash h of the key already computed
+     */
+    bool insertHashed(const Iterator &it, const Key &key, const Value &value, size_t h) {
+        if (!it.endFlag) {
+            slots.value(it.index) = value;
+            return false;
+        }
+        slots.construct(it.index, key, value);
+        if (control[it.index] == DELETED) --deletedSize;
+        setControl(it.index, h2(h));
+        ++tableSize;
+        if ((double) (tableSize + deletedSize) > maxLoadFactor * (double) capacity) rehash(capacity);
+        return true;
+    }
+
+    /**
+     * Hash a block of keys and prefetch the control bytes of their first groups,
+     * then the first slot in each group whose h2 matches, so the cache misses of the block overlap
+     * @param hashes set to the mixed hash of each key
+     */
+    void prefetchBlock(const Key *keys, size_t count, size_t *hashes) const {
+        for (size_t l = 0; l < count; l++) {
+            hashes[l] = mix(hash(keys[l]));
+            __builtin_prefetch(control + ((hashes[l] >> 7) & groupMask()) * GROUP_SIZE);
+        }
+        for (size_t l = 0; l < count; l++) {
+            size_t group = (hashes[l] >> 7) & groupMask();
+            uint32_t mask = Group(control + group * GROUP_SIZE).match(h2(hashes[l]));
+            if (mask) slots.prefetch(group * GROUP_SIZE + lowestBit(mask));
+        }
+    }
+
+    void allocate(size_t newCapacity) {
+        capacity = newCapacity;
+        control = new Control[capacity];
+        std::fill(control, control + capacity, EMPTY);
+        slots.allocate(capacity);
+    }
+
+    void deallocate() {
+        if (!control) return;
+        for (size_t i = 0; i < capacity; i++) {
+            if (control[i] >= 0) slots.destroy(i);
+        }
+        slots.deallocate(capacity);
+        delete[] control;
+        control = nullptr;
+        capacity = 0;
+    }
+
+    /**
+     * Find the minimum number of slots for the hashtable
+     * The minimum bucket size must satisfy all of the following requirements:
+     * - It is not less than (i.e. greater or equal to) the parameter bucketSize
+     * - It is greater than floor(tableSize / maxLoadFactor)
+     * - It is a power of 2 and at least GROUP_SIZE
+     * Time Complexity: O(1)
+     * @throw std::range_error if no such bucket size can be found
+     * @param bucketSize lower bound of the new number of slots
+     */
+    size_t findMinimumBucketSize(size_t bucketSize) const {
+        size_t lower = std::max(bucketSize, (size_t) ((double) tableSize / maxLoadFactor) + 1);
+        size_t result = GROUP_SIZE;
+        while (result < lower) {
+            if (result > (SIZE_MAX >> 1)) throw std::range_error("Out of Range");
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void copyFrom(const FlatHashTable &that) {
+        allocate(that.capacity);
+        for (size_t i = 0; i < capacity; i++) {
+            control[i] = that.control[i];
+            if (control[i] >= 0) slots.copy(i, that.slots, i);
+        }
+        tableSize = that.tableSize;
+        deletedSize = that.deletedSize;
+    }
+
+public:
+    FlatHashTable() :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(DEFAULT_BUCKET_SIZE);
+    }
+
+    explicit FlatHashTable(size_t bucketSize) :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(findMinimumBucketSize(bucketSize));
+    }
+
+    FlatHashTable(const FlatHashTable &that) :
+            maxLoadFactor(that.maxLoadFactor), hash(that.hash), keyEqual(that.keyEqual) {
+        copyFrom(that);
+    }
+
+    FlatHashTable &operator=(const FlatHashTable &that) {
+        if (this == &that) return *this;
+        deallocate();
+        maxLoadFactor = that.maxLoadFactor;
+        hash = that.hash;
+        keyEqual = that.keyEqual;
+        copyFrom(that);
+        return *this;
+    }
+
+    ~FlatHashTable() { deallocate(); }
+
+    Iterator begin() {
+        Iterator it(this, 0, false);
+        if (control[0] < 0) it.increment();
+        return it;
+    }
+
+    Iterator end() {
+        return Iterator(this, capacity, true);
+    }
+
+    /**
+     * Find whether the key exists in the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists in the hashtable
+     */
+    bool contains(const Key &key) {
+        return find(key) != end();
+    }
+
+    /**
+     * Find the value in hashtable by key
+     * If the key exists, iterator points to the corresponding value, and it.endFlag = false
+     * Otherwise, iterator points to the slot that the key were to be inserted, and it.endFlag = true
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return an iterator of the value
+     */
+    Iterator find(const Key &key) {
+        return findHashed(key, mix(hash(key)));
+    }
+
+    /**
+     * Find n keys, BATCH at a time: the keys of a block are hashed and their groups prefetched
+     * before any of them is probed
+     * Time Complexity: Amortized O(nk)
+     * @param keys
+     * @param n number of keys
+     * @param out set to the address of the value of each key, or nullptr if the key doesn't exist
+     * @return the number of keys found
+     */
+    size_t findBatch(const Key *keys, size_t n, Value **out) {
+        size_t hashes[BATCH];
+        size_t found = 0;
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            prefetchBlock(keys + start, count, hashes);
+            for (size_t l = 0; l < count; l++) {
+                Iterator it = findHashed(keys[start + l], hashes[l]);
+                out[start + l] = it.endFlag ? nullptr : &slots.value(it.index);
+                found += !it.endFlag;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Insert n pairs <keys[i], values[i]> in the same way as findBatch
+     * The table grows once per block before the block is prefetched, so no insert in the block rehashes
+     * If a key already exists, overwrite its value
+     * Time Complexity: Amortized O(nk)
+     * @return the number of insertions that took place
+     */
+    size_t insertBatch(const Key *keys, const Value *values, size_t n) {
+        size_t hashes[BATCH];
+        size_t inserted = 0;
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            double needed = (double) (tableSize + deletedSize + count);
+            if (needed > maxLoadFactor * (double) capacity) rehash((size_t) (needed / maxLoadFactor) + 1);
+            prefetchBlock(keys + start, count, hashes);
+            for (size_t l = 0; l < count; l++) {
+                Iterator it = findHashed(keys[start + l], hashes[l]);
+                inserted += insertHashed(it, keys[start + l], values[start + l], hashes[l]);
+            }
+        }
+        return inserted;
+    }
+
+    /**
+     * Insert value into the hashtable according to an iterator returned by find
+     * the function can be only be called if no other write actions are done to the hashtable after the find
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: O(k)
+     * @param it an iterator returned by find
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Iterator &it, const Key &key, const Value &value) {
+        return insertHashed(it, key, value, it.endFlag ? mix(hash(key)) : 0);
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        return insert(find(key), key, value);
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * DO NOT rehash in this function
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) return false;
+        erase(it);
+        return true;
+    }
+
+    /**
+     * Erase the key at the input iterator
+     * If the input iterator is the end iterator, do nothing and return the input iterator directly
+     * The slot is marked DELETED, so the probes passing it go on
+     * Time Complexity: O(1)
+     * @param it
+     * @return the iterator after the input iterator before the erase
+     */
+    Iterator erase(const Iterator &it) {
+        if (it.endFlag) return it;
+        slots.destroy(it.index);
+        setControl(it.index, DELETED);
+        --tableSize;
+        ++deletedSize;
+        Iterator next = it;
+        next.increment();
+        return next;
+    }
+
+    /**
+     * Get the reference of value by key in the hashtable
+     * If the key doesn't exist, create it first (use default constructor of Value)
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return reference of value
+     */
+    Value &operator[](const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) {
+            insert(it, key, Value());
+            it = find(key);
+        }
+        return it->second;
+    }
+
+    /**
+     * Rehash the hashtable according to the (hinted) number of slots
+     * The number of slots after rehash need not be same as the parameter bucketSize
+     * Instead, findMinimumBucketSize is called to get the correct number
+     * If the number of slots doesn't change, the table is still rebuilt to drop the DELETED slots
+     * Time Complexity: O(nk)
+     * @param bucketSize lower bound of the new number of slots
+     */
+    void rehash(size_t bucketSize) {
+        bucketSize = findMinimumBucketSize(bucketSize);
+        //a table full of DELETED slots is rebuilt at the same size, otherwise it grows
+        if (bucketSize == capacity && (double) (tableSize + deletedSize) > maxLoadFactor * (double) capacity &&
+            (double) tableSize * 2 > maxLoadFactor * (double) capacity) {
+            bucketSize = findMinimumBucketSize(capacity * 2);
+        }
+        if (bucketSize == capacity && deletedSize == 0) return;
+
+        Control *oldControl = control;
+        Slots oldSlots = slots;
+        size_t oldCapacity = capacity;
+        allocate(bucketSize);
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (oldControl[i] < 0) continue;
+            size_t h = mix(hash(oldSlots.key(i)));
+            size_t index = findFreeSlot(h);
+            slots.move(index, oldSlots, i);
+            setControl(index, h2(h));
+        }
+        deletedSize = 0;
+        oldSlots.deallocate(oldCapacity);
+        delete[] oldControl;
+    }
+
+    /**
+     * @return the number of elements in the hashtable
+     */
+    size_t size() const { return tableSize; }
+
+    /**
+     * @return the number of slots in the hashtable
+     */
+    size_t bucketSize() const { return capacity; }
+
+    /**
+     * @return the current load factor of the hashtable
+     */
+    double loadFactor() const { return (double) tableSize / (double) capacity; }
+
+    /**
+     * @return the maximum load factor of the hashtable
+     */
+    double getMaxLoadFactor() const { return maxLoadFactor; }
+
+    /**
+     * Set the max load factor
+     * A probe needs an EMPTY slot to stop, so the load factor must stay below 1
+     * @throw std::range_error if the load factor is too small or too large
+     * @param loadFactor
+     */
+    void setMaxLoadFactor(double loadFactor) {
+        if (loadFactor <= 1e-9 || loadFactor > 0.95) {
+            throw std::range_error("invalid load factor!");
+        }
+        maxLoadFactor = loadFactor;
+        rehash(capacity);
+    }
+};
+
+#endif //VE281P2_FLAT_HASHTABLE_HPP
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "hash_functions.hpp"
+
+//Quality and speed of HashFunctions, in the way of SMHasher
+//Usage: hash_bench
+//- avalanche: flipping any input bit must flip every output bit with probability close to 1/2
+//- buckets: structured integer keys and similar strings, put in a power of 2 number of buckets by the low bits of
+//  the hash, must fill them as evenly as random keys do (chi-square over degrees of freedom close to 1)
+//- throughput of mix and hashBytes against std::hash; each input depends on the previous hash, so the integers and
+//  the short strings measure the latency of one hash
+//Returns 1 if a quality check fails
+
+const double MAX_BIAS_MIX = 0.01;           // largest allowed |P(output bit flips) - 1/2|
+const double MAX_BIAS_BYTES = 0.02;         // fewer samples per input bit for the byte strings
+const double MAX_CHI = 1.05;                // largest allowed chi-square over degrees of freedom
+const int BUCKET_BITS = 16;
+const size_t KEYS_PER_BUCKET = 16;
+
+std::mt19937_64 random64(281);
+
+//The worst bias over every pair of input and output bit, for samples random inputs of length bytes
+template<typename Function>
+double avalanche(Function function, size_t bytes, size_t samples){
+    std::vector<unsigned char> input(bytes);
+    std::vector<size_t> flips(bytes*8*64);
+    for (size_t s=0;s<samples;s++){
+        for (auto &c : input) c = (unsigned char) random64();
+        uint64_t h = function(input.data(), bytes);
+        for (size_t bit=0;bit<bytes*8;bit++){
+            input[bit/8] ^= (unsigned char) (1u<<(bit%8));
+            uint64_t d = h^function(input.data(), bytes);
+            input[bit/8] ^= (unsigned char) (1u<<(bit%8));
+            for (size_t out=0;out<64;out++) flips[bit*64+out] += (d>>out)&1;
+        }
+    }
+    double worst = 0;
+    for (size_t f : flips) worst = std::max(worst, std::fabs((double) f/(double) samples-0.5));
+    return worst;
+}
+
+//Chi-square over degrees of freedom of the bucket counts, the bucket of a key is the low bits of its hash
+double chiSquare(const std::vector<uint64_t> &hashes){
+    size_t buckets = (size_t) 1<<BUCKET_BITS;
+    std::vector<double> counts(buckets);
+    for (uint64_t h : hashes) counts[h&(buckets-1)]++;
+    double expected = (double) hashes.size()/(double) buckets, chi = 0;
+    for (double c : counts) chi += (c-expected)*(c-expected)/expected;
+    return chi/(double) (buckets-1);
+}
+
+template<typename Function>
+double seconds(Function function){
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+volatile uint64_t sink;
+
+int main(){
+    bool good = true;
+    auto check = [&good](bool passed){
+        good &= passed;
+        return passed ? "" : "\tFAIL";
+    };
+
+    std::cout<<"avalanche\tworst bias\n";
+    double bias = avalanche([](const unsigned char *p, size_t){ return HashFunctions::mix(HashFunctions::read8(p)); },
+                            8, (size_t) 1<<18);
+    std::cout<<"mix\t"<<bias<<check(bias<=MAX_BIAS_MIX)<<"\n";
+    for (size_t bytes : {4, 8, 12, 16, 24, 32, 48, 64, 100}){
+        bias = avalanche([](const unsigned char *p, size_t n){ return HashFunctions::hashBytes(p, n); },
+                         bytes, (size_t) 1<<15);
+        std::cout<<"hashBytes "<<bytes<<"\t"<<bias<<check(bias<=MAX_BIAS_BYTES)<<"\n";
+    }
+
+    std::cout<<"\nbuckets\tHashFunctions chi2/df\tstd::hash chi2/df\n";
+    size_t n = KEYS_PER_BUCKET<<BUCKET_BITS;
+    struct KeySet {
+        const char *name;
+        uint64_t first, stride;
+    };
+    const KeySet keySets[] = {
+            {"sequential", 0, 1},
+            {"stride 4096", 0, 4096},
+            {"stride 2^32", 0, 1ull<<32},
+            {"pointers", 0x7f0000000000ull, 48},
+    };
+    std::vector<uint64_t> ours(n), standard(n);
+    for (const auto &keys : keySets){
+        for (size_t i=0;i<n;i++){
+            uint64_t key = keys.first+i*keys.stride;
+            ours[i] = HashFunctions::Hash<uint64_t>()(key);
+            standard[i] = std::hash<uint64_t>()(key);
+        }
+        double chi = chiSquare(ours);
+        std::cout<<keys.name<<"\t"<<chi<<"\t"<<chiSquare(standard)<<check(chi<=MAX_CHI)<<"\n";
+    }
+    for (size_t i=0;i<n;i++){
+        std::string key = "key" + std::to_string(i);
+        ours[i] = HashFunctions::Hash<std::string>()(key);
+        standard[i] = std::hash<std::string>()(key);
+    }
+    double chi = chiSquare(ours);
+    std::cout<<"strings\t"<<chi<<"\t"<<chiSquare(standard)<<check(chi<=MAX_CHI)<<"\n";
+    for (size_t i=0;i<n;i++){
+        ours[i] = HashFunctions::hashValues((int) (i>>8), (int) (i&255));
+        standard[i] = std::hash<int>()((int) (i>>8))*31+std::hash<int>()((int) (i&255));
+    }
+    chi = chiSquare(ours);
+    std::cout<<"pairs (h1*31+h2)\t"<<chi<<"\t"<<chiSquare(standard)<<check(chi<=MAX_CHI)<<"\n";
+
+    std::cout<<"\nthroughput\tHashFunctions\tstd::hash\n";
+    const size_t INTEGERS = 100000000;
+    double a = seconds([&](){
+        uint64_t h = 0;
+        for (uint64_t i=0;i<INTEGERS;i++) h += HashFunctions::mix(i^h);
+        sink = h;
+    });
+    double b = seconds([&](){
+        uint64_t h = 0;
+        for (uint64_t i=0;i<INTEGERS;i++) h += std::hash<uint64_t>()(i^h);
+        sink = h;
+    });
+    std::cout<<"integers ns/hash\t"<<a*1e9/INTEGERS<<"\t"<<b*1e9/INTEGERS<<"\n";
+    std::string text((1<<20)+8, 'x');     // the reads start at one of the first 8 bytes
+    for (auto &c : text) c = (char) random64();
+    for (size_t bytes : {8, 16, 64, 256, 1<<20}){
+        size_t rounds = ((size_t) 1<<30)/bytes;
+        a = seconds([&](){
+            uint64_t h = 0;
+            for (size_t r=0;r<rounds;r++) h += HashFunctions::hashBytes(text.data()+(h&7), bytes);
+            sink = h;
+        });
+        b = seconds([&](){
+            uint64_t h = 0;
+            for (size_t r=0;r<rounds;r++){
+                h += std::hash<std::string_view>()(std::string_view(text.data()+(h&7), bytes));
+            }
+            sink = h;
+        });
+        std::cout<<bytes<<" bytes GB/s\t"<<(double) (1<<30)/a/1e9<<"\t"<<(double) (1<<30)/b/1e9<<"\n";
+    }
+    return good ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+#ifndef VE281P2_HASH_FUNCTIONS_HPP
+#define VE281P2_HASH_FUNCTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Hash functions to use as the Hash parameter of the hashtables, instead of std::hash
+ * std::hash of an integer is the integer itself in libstdc++; the hashtables spread it before taking bits
+ * (PowerOfTwoSizePolicy by Fibonacci hashing, the open addressing tables by their own mix), but code that takes
+ * the low bits of a hash directly puts keys with the same low bits (multiples of a power of 2, pointers,
+ * packed ids) into few buckets, and std::hash has nothing for pair, tuple or struct keys;
+ * here every bit of the key changes about half of the bits of the hash, which hash_bench.cpp checks
+ * - mix: a multiply-xorshift finalizer for 64-bit integers
+ * - hashBytes: a wyhash style hash of a byte string, reading 16 bytes per step with 64x64->128 bit multiplies
+ * - combine / hashValues: mix the hash values of several fields, for pair, tuple and struct keys
+ * - Hash<T>: a function object for integers, enums, pointers, strings, pairs and tuples;
+ *   for strings it is transparent, so a std::string table can be searched by std::string_view or const char *
+ */
+namespace HashFunctions {
+    static constexpr uint64_t DEFAULT_SEED = 0x2d358dccaa6c78a5ull;
+
+    /**
+     * A bijective mixer, the finalizer of moremur
+     * Time Complexity: O(1)
+     */
+    inline uint64_t mix(uint64_t x) {
+        x ^= x >> 27;
+        x *= 0x3c79ac492ba7b653ull;
+        x ^= x >> 33;
+        x *= 0x1c69b3f74ac4ae35ull;
+        x ^= x >> 27;
+        return x;
+    }
+
+    /**
+     * Multiply to 128 bits and fold the halves together
+     */
+    inline uint64_t mum(uint64_t a, uint64_t b) {
+        __uint128_t product = (__uint128_t) a * b;
+        return (uint64_t) product ^ (uint64_t) (product >> 64);
+    }
+
+    inline uint64_t read8(const unsigned char *p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t read4(const unsigned char *p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    /**
+     * Hash a byte string, in the way of wyhash
+     * Time Complexity: O(length)
+     * @param data
+     * @param length number of bytes
+     * @param seed different seeds give independent hash functions
+     */
+    inline uint64_t hashBytes(const void *data, size_t length, uint64_t seed = DEFAULT_SEED) {
+        static constexpr uint64_t P0 = 0xa0761d6478bd642full, P1 = 0xe7037ed1a0b428dbull,
+                P2 = 0x8ebc6af09c88c6e3ull, P3 = 0x589965cc75374cc3ull;
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        seed ^= mum(seed ^ P0, P1);
+        uint64_t a, b;
+        if (length <= 16) {
+            if (length >= 4) {
+                //two overlapping reads from each end cover 4 to 16 bytes
+                size_t middle = (length >> 3) << 2;
+                a = (read4(p) << 32) | read4(p + middle);
+                b = (read4(p + length - 4) << 32) | read4(p + length - 4 - middle);
+            }
+            else if (length > 0) {
+                a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+                b = 0;
+            }
+            else a = b = 0;
+        }
+        else {
+            size_t i = length;
+            if (i > 48) {
+                //three independent lanes keep the multipliers busy
+                uint64_t seed1 = seed, seed2 = seed;
+                do {
+                    seed = mum(read8(p) ^ P1, read8(p + 8) ^ seed);
+                    seed1 = mum(read8(p + 16) ^ P2, read8(p + 24) ^ seed1);
+                    seed2 = mum(read8(p + 32) ^ P3, read8(p + 40) ^ seed2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while (i > 16) {
+                seed = mum(read8(p) ^ P1, read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        a ^= P1;
+        b ^= seed;
+        __uint128_t product = (__uint128_t) a * b;
+        return mum((uint64_t) product ^ P0 ^ length, (uint64_t) (product >> 64) ^ P1);
+    }
+
+    /**
+     * Combine a hash value into the hash value of the fields before it
+     * Not symmetric: the order of the fields matters
+     * Time Complexity: O(1)
+     */
+    inline uint64_t combine(uint64_t seed, uint64_t value) {
+        return mum(seed ^ 0xe7037ed1a0b428dbull, value ^ 0xa0761d6478bd642full);
+    }
+
+    template<typename T, typename = void>
+    struct Hash;
+
+    /**
+     * Hash several values with Hash and combine them
+     * e.g. for a struct key: return HashFunctions::hashValues(key.name, key.id);
+     */
+    template<typename... Ts>
+    uint64_t hashValues(const Ts &... values) {
+        uint64_t seed = DEFAULT_SEED;
+        ((seed = combine(seed, Hash<Ts>()(values))), ...);
+        return seed;
+    }
+
+    // integers, enums and pointers
+    template<typename T>
+    struct Hash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value ||
+                                           std::is_pointer<T>::value>::type> {
+        size_t operator()(T value) const {
+            if constexpr (std::is_pointer<T>::value) return (size_t) mix((uint64_t) (uintptr_t) value);
+            else return (size_t) mix((uint64_t) value);
+        }
+    };
+
+    // strings, transparent over std::string, std::string_view and const char *
+    template<typename T>
+    struct Hash<T, typename std::enable_if<std::is_same<T, std::string>::value ||
+                                           std::is_same<T, std::string_view>::value>::type> {
+        typedef void is_transparent;
+
+        size_t operator()(std::string_view s) const { return (size_t) hashBytes(s.data(), s.size()); }
+    };
+
+    template<typename First, typename Second>
+    struct Hash<std::pair<First, Second>> {
+        size_t operator()(const std::pair<First, Second> &p) const {
+            return (size_t) hashValues(p.first, p.second);
+        }
+    };
+
+    template<typename... Ts>
+    struct Hash<std::tuple<Ts...>> {
+        size_t operator()(const std::tuple<Ts...> &t) const {
+            return (size_t) std::apply([](const Ts &... values) { return hashValues(values...); }, t);
+        }
+    };
+
+    // floating point, the value of std::hash mixed again
+    template<typename T>
+    struct Hash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+        size_t operator()(T value) const { return (size_t) mix((uint64_t) std::hash<T>()(value)); }
+    };
+}
+
+#endif //VE281P2_HASH_FUNCTIONS_HPP
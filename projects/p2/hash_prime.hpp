@@ -1,5 +1,11 @@
 // adopted from /usr/include/c++/10.2.0/ext/pb_ds/detail/resize_policy/hash_prime_size_policy_imp.hpp
 
+#ifndef VE281P2_HASH_PRIME_HPP
+#define VE281P2_HASH_PRIME_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 #include <utility>
 
 namespace HashPrime {
@@ -77,4 +83,82 @@ namespace HashPrime {
             /* 61    */ (std::size_t) 18446744073709551557ull,
     };
 
+
+    __extension__ typedef unsigned __int128 uint128;
+
+    /**
+     * Size policies of HashTable, they decide the possible numbers of buckets and map a hash value to a bucket
+     * A policy provides:
+     * - static size_t nextSize(size_t n): the smallest possible size not less than n
+     * - void setSize(size_t size): called whenever the number of buckets changes
+     * - size_t index(size_t hash) const: the bucket of a hash value, in [0, size)
+     */
+
+    /**
+     * Prime sizes from g_a_sizes, the bucket is hash % size
+     * The modulo uses Lemire's fastmod with a constant precomputed per size: two multiplications instead of
+     * a 64-bit division, giving exactly the same bucket. Sizes of 2^32 and above fall back to the division
+     */
+    class PrimeSizePolicy {
+        size_t size = 1;
+        uint128 factor = 0;     // ceil(2^128 / size), 0 if size is too large for fastmod
+
+    public:
+        /**
+         * Time Complexity: O(1)
+         * @throw std::range_error if n is larger than every size in g_a_sizes
+         */
+        static size_t nextSize(size_t n) {
+            auto found = std::lower_bound(g_a_sizes, g_a_sizes + num_distinct_sizes, n);
+            if (found == g_a_sizes + num_distinct_sizes) throw std::range_error("Out of Range");
+            return *found;
+        }
+
+        void setSize(size_t newSize) {
+            size = newSize;
+            factor = (uint64_t) size < (1ull << 32) ? ~(uint128) 0 / size + 1 : 0;
+        }
+
+        size_t index(size_t hash) const {
+            if (factor == 0) return hash % size;
+            uint128 low = factor * (uint64_t) hash;
+            uint128 bottom = ((low & UINT64_MAX) * (uint64_t) size) >> 64;
+            uint128 top = (low >> 64) * (uint64_t) size;
+            return (size_t) ((bottom + top) >> 64);
+        }
+    };
+
+    /**
+     * Power of 2 sizes, the bucket is the high bits of the hash multiplied by 2^64 / golden ratio
+     * The multiplication mixes the low bits of the hash into the high bits, so hashes that only differ
+     * in their high bits (or std::hash of integers, which is the identity) still spread over the buckets
+     */
+    class PowerOfTwoSizePolicy {
+        unsigned shift = 63;    // 64 - log2(size)
+
+    public:
+        static constexpr size_t MIN_SIZE = 8;
+
+        /**
+         * Time Complexity: O(1)
+         * @throw std::range_error if n is larger than 2^63
+         */
+        static size_t nextSize(size_t n) {
+            if (n > (SIZE_MAX >> 1) + 1) throw std::range_error("Out of Range");
+            size_t result = MIN_SIZE;
+            while (result < n) result <<= 1;
+            return result;
+        }
+
+        void setSize(size_t newSize) {
+            shift = 64 - (unsigned) __builtin_ctzll(newSize);
+        }
+
+        size_t index(size_t hash) const {
+            return (size_t) (((uint64_t) hash * 0x9e3779b97f4a7c15ull) >> shift);
+        }
+    };
+
 }
+
+#endif //VE281P2_HASH_PRIME_HPP
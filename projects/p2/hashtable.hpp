@@ -1,11 +1,57 @@
+#ifndef VE281P2_HASHTABLE_HPP
+#define VE281P2_HASHTABLE_HPP
+
 #include "hash_prime.hpp"
+#include "node_pool.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <vector>
 #include <forward_list>
+#include <iterator>
+#include <map>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include <iostream>
+
+//whether a function object accepts arguments of other types than the key type, by defining is_transparent
+template<typename T, typename = void>
+struct IsTransparent : std::false_type {};
+
+template<typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+//the hash value of the key of a node, stored in the node
+template<bool Stored>
+struct HashCode {
+    size_t hashValue = 0;
+
+    void setHash(size_t h) { hashValue = h; }
+
+    template<typename Hash, typename Key>
+    size_t getHash(const Hash &, const Key &) const { return hashValue; }
+
+    bool hashMatches(size_t h) const { return hashValue == h; }
+};
+
+//or computed again every time, without any space in the node
+template<>
+struct HashCode<false> {
+    void setHash(size_t) {}
+
+    template<typename Hash, typename Key>
+    size_t getHash(const Hash &hash, const Key &key) const { return hash(key); }
+
+    bool hashMatches(size_t) const { return true; }
+};
+
 /**
  * The Hashtable class
  * The time complexity of functions are based on n and k
@@ -15,18 +61,61 @@
  * @tparam Value        data type
  * @tparam Hash         function object, return the hash value of a key
  * @tparam KeyEqual     function object, return whether two keys are the same
+ * @tparam SizePolicy   possible numbers of buckets and the map from a hash value to a bucket (hash_prime.hpp)
+ * @tparam Allocator    allocator of the list nodes, shared by all buckets (by default from a NodePool owned by
+ *                      the hashtable, node_pool.hpp)
+ * @tparam StoreHash    whether every node stores the hash value of its key, then rehash never calls Hash,
+ *                      and find only calls KeyEqual for keys with the same hash value (good for long keys)
+ * If both Hash and KeyEqual define is_transparent, find, contains and erase also accept any type they accept,
+ * e.g. a std::string_view for std::string keys, without constructing a Key
  */
 template<
         typename Key, typename Value,
         typename Hash = std::hash<Key>,
-        typename KeyEqual = std::equal_to<Key>
+        typename KeyEqual = std::equal_to<Key>,
+        typename SizePolicy = HashPrime::PrimeSizePolicy,
+        typename Allocator = NodePoolAllocator<std::pair<const Key, Value>>,
+        bool StoreHash = false
 >
 class HashTable {
 public:
     typedef std::pair<const Key, Value> HashNode;
-    typedef std::forward_list<HashNode> HashNodeList;
+
+    /**
+     * The element of the lists, a node and the hash value of its key if StoreHash
+     */
+    struct Entry : HashCode<StoreHash> {
+        HashNode node;
+
+        template<typename... Args>
+        explicit Entry(size_t hashValue, Args &&... args) : node(std::forward<Args>(args)...) {
+            this->setHash(hashValue);
+        }
+
+        size_t getHash(const Hash &hash) const { return HashCode<StoreHash>::getHash(hash, node.first); }
+    };
+
+    typedef std::forward_list<Entry, typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>> HashNodeList;
     typedef std::vector<HashNodeList> HashTableData;
 
+    /**
+     * How well the keys are spread over the buckets, returned by stats
+     * A comparison is a visit to a node: with StoreHash, it compares the hash values and only calls KeyEqual
+     * if they are equal
+     */
+    struct Stats {
+        std::vector<size_t> chainLengths;       // chainLengths[l] is the number of buckets with l nodes
+        double successfulComparisons = 0;       // average comparisons to find a key in the hashtable
+        size_t maxSuccessfulComparisons = 0;
+        double unsuccessfulComparisons = 0;     // average comparisons to miss, over a random bucket
+        size_t maxUnsuccessfulComparisons = 0;  // the length of the longest chain
+        size_t rehashCount = 0;                 // rehashes since construction or resetStats, shrinks included
+        double rehashSeconds = 0;               // time spent in them (an incremental rehash only counts its start)
+        double bytesPerEntry = 0;               // buckets and nodes, over the number of elements
+        size_t sampledLookups = 0;              // lookups sampled by setLookupSampling
+        size_t sampledKeyEqualCalls = 0;        // KeyEqual calls made by those lookups
+    };
+
     /**
      * A single directional iterator for the hashtable
      * ! DO NOT NEED TO MODIFY THIS !
@@ -40,6 +129,7 @@ public:
         VectorIterator bucketIt;    // an iterator of the buckets, which represents a instance of forward_list  
         ListIterator listItBefore;  // a before iterator of the list, here we use "before" for quick erase and insert
         bool endFlag = false;       // whether it is an end iterator
+        size_t hashValue = 0;       // for an iterator returned by find, the hash value of the key, used by insert
 
         /**
          * Increment the iterator
@@ -59,12 +149,13 @@ public:
                     return;
                 }
             }  //check whether before is the last 2 element
-            while (++bucketIt != hashTable->buckets.end()) {//find a non-empty bucket
-                if (!bucketIt->empty()) {
-                    // use the first element in a new forward_list
-                    listItBefore = bucketIt->before_begin();
-                    return;
-                }
+            //find a non-empty bucket, 64 buckets at a time in the occupancy bitmap
+            size_t index = (size_t) (bucketIt - hashTable->buckets.begin());
+            bucketIt += (std::ptrdiff_t) (hashTable->nextOccupied(index + 1) - index);
+            if (bucketIt != hashTable->buckets.end()) {
+                // use the first element in a new forward_list
+                listItBefore = bucketIt->before_begin();
+                return;
             }
             endFlag = true;
         }
@@ -115,28 +206,66 @@ public:
         HashNode *operator->() {
             auto listIt = listItBefore;
             ++listIt;
-            return &(*listIt);
+            return &listIt->node;
         }
 
         HashNode &operator*() {
             auto listIt = listItBefore;
             ++listIt;
-            return *listIt;
+            return listIt->node;
         }
 
     };
 
 protected:                                                                  // DO NOT USE private HERE!
     static constexpr double DEFAULT_LOAD_FACTOR = 0.5;                      // default maximum load factor is 0.5
-    static constexpr size_t DEFAULT_BUCKET_SIZE = HashPrime::g_a_sizes[0];  // default number of buckets is 5
+    static constexpr size_t DEFAULT_BUCKET_SIZE = HashPrime::g_a_sizes[0];  // default number of buckets is 5 (8 for powers of 2)
 
+    NodeStorage<Allocator> nodeStorage;                                     // the node pool, destroyed after every list
     HashTableData buckets;                                                  // buckets, of singly linked lists
     typename HashTableData::iterator firstBucketIt;                         // help get begin iterator in O(1) time
+    std::vector<uint64_t> occupancy;                                        // bit i is set iff bucket i is not empty
 
     size_t tableSize;                                                       // number of elements
     double maxLoadFactor;                                                   // maximum load factor
+    double minLoadFactor = 0;                                               // minimum load factor, 0 if erase never shrinks
     Hash hash;                                                              // hash function instance
     KeyEqual keyEqual;                                                      // key equal function instance
+    SizePolicy sizePolicy;                                                  // maps a hash value to a bucket
+    Allocator allocator = nodeStorage.allocator();                          // allocates the nodes of every bucket
+
+    static constexpr size_t BATCH = 16;                                     // keys hashed and prefetched together
+
+    // incremental rehash: the nodes move from oldBuckets to buckets a few buckets per operation
+    static constexpr size_t MIGRATE_STEP = 16;                              // old buckets moved per find
+    bool incremental = false;                                               // whether insert rehashes incrementally
+    bool rehashing = false;                                                 // whether oldBuckets still holds nodes
+    HashTableData oldBuckets;                                               // buckets before the rehash
+    SizePolicy oldSizePolicy;                                               // size policy of oldBuckets
+    size_t migrated = 0;                                                    // old buckets before this one are moved
+
+    // instrumentation, read by stats
+    size_t rehashCount = 0;                                                 // number of rehashes
+    double rehashSeconds = 0;                                               // time spent in rehash
+    size_t sampleEvery = 0;                                                 // sample one lookup in sampleEvery, 0 for none
+    size_t sampleTick = 0;                                                  // lookups since the last sample
+    size_t sampledLookups = 0;
+    size_t sampledKeyEqualCalls = 0;
+
+    /**
+     * Adds the time from its construction to its destruction to rehashSeconds
+     */
+    class RehashTimer {
+        HashTable &table;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit RehashTimer(HashTable &table) : table(table), start(std::chrono::steady_clock::now()) {}
+
+        ~RehashTimer() {
+            table.rehashSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
 
     /**
      * Time Complexity: O(k)
@@ -145,7 +274,9 @@ protected:                                                                  // D
      * @return the hash value of key with a new bucket size
      */
     inline size_t hashKey(const Key &key, size_t bucketSize) const {
-        return hash(key) % bucketSize;
+        SizePolicy policy;
+        policy.setSize(bucketSize);
+        return policy.index(hash(key));
     }
 
     /**
@@ -154,7 +285,58 @@ protected:                                                                  // D
      * @return the hash value of key with current bucket size
      */
     inline size_t hashKey(const Key &key) const {
-        return hash(key) % buckets.size();
+        return sizePolicy.index(hash(key));
+    }
+
+    /**
+     * Every list is constructed with allocator, lists copied from one another would lose the pool,
+     * and nodes can only be spliced between lists with equal allocators
+     * @return a vector of empty buckets
+     */
+    HashTableData makeBuckets(size_t bucketSize) const {
+        HashTableData data;
+        data.reserve(bucketSize);
+        for (size_t i = 0; i < bucketSize; i++) data.emplace_back(allocator);
+        return data;
+    }
+
+    /**
+     * @return a copy of data, with the nodes allocated by allocator
+     */
+    HashTableData copyBuckets(const HashTableData &data) const {
+        HashTableData copy = makeBuckets(data.size());
+        for (size_t i = 0; i < data.size(); i++) copy[i].assign(data[i].begin(), data[i].end());
+        return copy;
+    }
+
+    /**
+     * Replace the bucket vector and let the size policy know
+     * @param bucketSize a size returned by findMinimumBucketSize
+     */
+    void resizeBuckets(size_t bucketSize) {
+        buckets = makeBuckets(bucketSize);
+        sizePolicy.setSize(bucketSize);
+        occupancy = std::vector<uint64_t>((bucketSize + 63) / 64, 0);
+    }
+
+    void markOccupied(size_t index) { occupancy[index >> 6] |= uint64_t(1) << (index & 63); }
+
+    void markEmpty(size_t index) { occupancy[index >> 6] &= ~(uint64_t(1) << (index & 63)); }
+
+    /**
+     * Time Complexity: O(number of buckets / 64) at worst
+     * @return the index of the first non-empty bucket at or after index, or the number of buckets if none
+     */
+    size_t nextOccupied(size_t index) const {
+        size_t word = index >> 6;
+        if (word >= occupancy.size()) return buckets.size();
+        //no std::countr_zero before C++20
+        uint64_t bits = occupancy[word] & (~uint64_t(0) << (index & 63));
+        while (!bits) {
+            if (++word == occupancy.size()) return buckets.size();
+            bits = occupancy[word];
+        }
+        return word * 64 + (size_t) __builtin_ctzll(bits);
     }
 
     /**
@@ -162,58 +344,265 @@ protected:                                                                  // D
      * The minimum bucket size must satisfy all of the following requirements:
      * - It is not less than (i.e. greater or equal to) the parameter bucketSize
      * - It is greater than floor(tableSize / maxLoadFactor)
-     * - It is a (prime) number defined in HashPrime (hash_prime.hpp)
+     * - It is a size allowed by SizePolicy (by default a prime number defined in HashPrime (hash_prime.hpp))
      * - It is minimum if satisfying all other requirements
      * Time Complexity: O(1)
      * @throw std::range_error if no such bucket size can be found
      * @param bucketSize lower bound of the new number of buckets
      */
     size_t findMinimumBucketSize(size_t bucketSize) const {
-        auto find =  std::lower_bound(HashPrime::g_a_sizes, HashPrime::g_a_sizes+62, bucketSize+1 );
-        if(find) return *find;
-        else throw std::range_error("Out of Range");
-        // TODO: implement this function
+        size_t minimum = (size_t) ((double) tableSize / maxLoadFactor) + 1;
+        return SizePolicy::nextSize(std::max(bucketSize, minimum));
     }
 
 
 
     // TODO: define your helper functions here if necessary
 
+    /**
+     * Move every node of an old bucket into buckets
+     * A node is linked after the last node of its new bucket, so every node already there keeps its
+     * predecessor, and the iterators returned by earlier finds still point to their keys
+     * Time Complexity: O(k) per node, plus the length of its new bucket
+     */
+    void migrateBucket(HashNodeList &bucket) {
+        while (!bucket.empty()) {
+            auto targetIt = buckets.begin() + sizePolicy.index(bucket.front().getHash(hash));
+            auto lastIt = targetIt->before_begin();
+            for (auto listIt = targetIt->begin(); listIt != targetIt->end(); ++listIt) lastIt = listIt;
+            targetIt->splice_after(lastIt, bucket, bucket.before_begin());
+            markOccupied((size_t) (targetIt - buckets.begin()));
+            if (firstBucketIt == buckets.end() || targetIt < firstBucketIt) firstBucketIt = targetIt;
+        }
+    }
+
+    /**
+     * Move the next MIGRATE_STEP old buckets, release oldBuckets when all of them are moved
+     * Time Complexity: O(k) per node moved
+     */
+    void migrateStep() {
+        for (size_t i = 0; i < MIGRATE_STEP && migrated < oldBuckets.size(); i++) {
+            migrateBucket(oldBuckets[migrated++]);
+        }
+        if (migrated == oldBuckets.size()) {
+            HashTableData().swap(oldBuckets);
+            rehashing = false;
+        }
+    }
+
+    /**
+     * Finish an incremental rehash in progress
+     * Time Complexity: O(nk)
+     */
+    void finishRehash() {
+        while (rehashing) migrateStep();
+    }
+
+    // lookups by other types than Key are enabled by transparent Hash and KeyEqual
+    static constexpr bool TRANSPARENT = IsTransparent<Hash>::value && IsTransparent<KeyEqual>::value;
+
+    template<typename K>
+    using EnableTransparent = typename std::enable_if<TRANSPARENT && sizeof(K) != 0>::type;
+
+    /**
+     * Find for Key, or for any type accepted by transparent Hash and KeyEqual
+     * Time Complexity: Amortized O(k)
+     */
+    template<typename K>
+    Iterator findKey(const K &key) {
+        return findHashed(key, hash(key));   //hash only once
+    }
+
+    template<typename K>
+    Iterator findHashed(const K &key, size_t hashValue) {
+        if (rehashing) {
+            migrateBucket(oldBuckets[oldSizePolicy.index(hashValue)]);
+            migrateStep();
+        }
+        return findInBucket(buckets.begin() + sizePolicy.index(hashValue), key, hashValue);
+    }
+
+    /**
+     * Search the bucket of the key for the key
+     * If the key is not found, the iterator points to the front of the bucket, and it.endFlag = true
+     * Time Complexity: O(k) per node in the bucket
+     */
+    template<typename K>
+    Iterator findInBucket(typename HashTableData::iterator bucketIt, const K &key, size_t hashValue) {
+        if (sampleEvery && ++sampleTick == sampleEvery) {
+            sampleTick = 0;
+            ++sampledLookups;
+            for (auto &entry : *bucketIt) {
+                if (!entry.hashMatches(hashValue)) continue;
+                ++sampledKeyEqualCalls;
+                if (keyEqual(entry.node.first, key)) break;
+            }
+        }
+        Iterator found(this, bucketIt, bucketIt->before_begin());
+        found.hashValue = hashValue;
+        for (auto listIt = bucketIt->begin(); listIt != bucketIt->end(); found.listItBefore = listIt++) {
+            //with StoreHash, keys of other hash values are skipped without being read
+            if (listIt->hashMatches(hashValue) && keyEqual(listIt->node.first, key)) return found;
+        }
+        found.listItBefore = bucketIt->before_begin();
+        found.endFlag = true;
+        return found;
+    }
+
+    template<typename K>
+    bool eraseKey(const K &key) {
+        Iterator it = findKey(key);
+        if(it.endFlag) return !it.endFlag;
+        erase(it);
+        shrinkIfSparse();
+        return !it.endFlag;
+    }
+
+    /**
+     * Shrink the hashtable if the load factor is below minLoadFactor
+     * The new load factor is at most half of maxLoadFactor, so it takes many inserts to grow again
+     * Time Complexity: O(1), or the time of a rehash
+     */
+    void shrinkIfSparse() {
+        if (loadFactor() >= minLoadFactor) return;
+        size_t target = (size_t) (2 * (double) tableSize / maxLoadFactor) + 1;
+        if (SizePolicy::nextSize(target) >= buckets.size()) return;
+        if (incremental) startRehash(target);
+        else rehash(target);
+    }
+
+    /**
+     * Hash a block of keys and prefetch their buckets, then the first node of each bucket,
+     * so the cache misses of the block overlap instead of following one another
+     * During an incremental rehash only the new buckets are prefetched
+     * @param hashes set to the hash value of each key
+     */
+    void prefetchBlock(const Key *keys, size_t count, size_t *hashes) const {
+        for (size_t l = 0; l < count; l++) {
+            hashes[l] = hash(keys[l]);
+            __builtin_prefetch(&buckets[sizePolicy.index(hashes[l])]);
+        }
+        for (size_t l = 0; l < count; l++) {
+            const HashNodeList &bucket = buckets[sizePolicy.index(hashes[l])];
+            if (!bucket.empty()) __builtin_prefetch(&bucket.front());
+        }
+    }
+
+    /**
+     * Count a node just linked after it.listItBefore: update firstBucketIt and the size, rehash if needed
+     * Time Complexity: O(1), or the time of a rehash
+     * @param it the iterator returned by find that the node is linked at
+     * @return an iterator of the node
+     */
+    Iterator linked(const Iterator &it) {
+        if (firstBucketIt == buckets.end() || it.bucketIt < firstBucketIt) firstBucketIt = it.bucketIt;
+        markOccupied((size_t) (it.bucketIt - buckets.begin()));
+        ++tableSize;
+        if (maxLoadFactor < loadFactor()) {
+            //a rehash splices the nodes, so the key stays where it is
+            const Key &key = std::next(it.listItBefore)->node.first;
+            if (incremental) startRehash(buckets.size());
+            else rehash(buckets.size());
+            return find(key);
+        }
+        return Iterator(this, it.bucketIt, it.listItBefore);
+    }
+
+    /**
+     * Construct a node from args in place, at an iterator returned by find with it.endFlag = true
+     * Time Complexity: O(1) plus the construction of the node, or the time of a rehash
+     * @return an iterator of the node
+     */
+    template<typename... Args>
+    Iterator emplaceAt(const Iterator &it, Args &&... args) {
+        it.bucketIt->emplace_after(it.listItBefore, it.hashValue, std::forward<Args>(args)...);
+        return linked(it);
+    }
+
+    template<typename K, typename... Args>
+    std::pair<Iterator, bool> tryEmplaceKey(K &&key, Args &&... args) {
+        Iterator it = find(key);
+        if (!it.endFlag) return {it, false};
+        return {emplaceAt(it, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                          std::forward_as_tuple(std::forward<Args>(args)...)), true};
+    }
+
+    /**
+     * Switch to a new bucket vector and leave the nodes in oldBuckets, to be moved by later operations
+     * Time Complexity: O(number of buckets), the nodes are not touched
+     * @param bucketSize lower bound of the new number of buckets
+     */
+    void startRehash(size_t bucketSize) {
+        finishRehash();
+        bucketSize = findMinimumBucketSize(bucketSize);
+        if (bucketSize == buckets.size()) return;
+        RehashTimer timer(*this);
+        ++rehashCount;
+        oldBuckets.swap(buckets);
+        oldSizePolicy = sizePolicy;
+        resizeBuckets(bucketSize);
+        firstBucketIt = buckets.end();
+        migrated = 0;
+        rehashing = true;
+    }
+
 
 public:
     HashTable() :
-            buckets(DEFAULT_BUCKET_SIZE), tableSize(0), maxLoadFactor(DEFAULT_LOAD_FACTOR),
+            tableSize(0), maxLoadFactor(DEFAULT_LOAD_FACTOR),
             hash(Hash()), keyEqual(KeyEqual()) {
+        resizeBuckets(SizePolicy::nextSize(DEFAULT_BUCKET_SIZE));
         firstBucketIt = buckets.end();
     }
 
     explicit HashTable(size_t bucketSize) :
             tableSize(0), maxLoadFactor(DEFAULT_LOAD_FACTOR),
             hash(Hash()), keyEqual(KeyEqual()) {
-        bucketSize = findMinimumBucketSize(bucketSize);
-        buckets.resize(bucketSize);
+        resizeBuckets(findMinimumBucketSize(bucketSize));
         firstBucketIt = buckets.end();
     }
 
+    /**
+     * Construct from the pairs in [first, last) with bulkLoad
+     * @tparam InputIt an iterator of pairs (key, value)
+     */
+    template<typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+    HashTable(InputIt first, InputIt last) : HashTable() {
+        bulkLoad(first, last);
+    }
+
     HashTable(const HashTable &that){
         if(this != &that) *this = that;
         // TODO: implement this function
     }
 
     HashTable &operator=(const HashTable &that) {
+        if (this == &that) return *this;
         tableSize = that.tableSize;
         maxLoadFactor = that.maxLoadFactor;
+        minLoadFactor = that.minLoadFactor;
         hash = that.hash;
         keyEqual = that.keyEqual;
-        buckets = that.buckets;
-        firstBucketIt = find((that.firstBucketIt->begin())->first).bucketIt;
+        sizePolicy = that.sizePolicy;
+        buckets = copyBuckets(that.buckets);
+        firstBucketIt = buckets.begin() + (that.firstBucketIt - that.buckets.begin());
+        occupancy = that.occupancy;
+        incremental = that.incremental;
+        rehashing = that.rehashing;
+        oldBuckets = copyBuckets(that.oldBuckets);
+        oldSizePolicy = that.oldSizePolicy;
+        migrated = that.migrated;
         return *this;
         // TODO: implement this function
     };
 
     ~HashTable() = default;
 
+    /**
+     * An incremental rehash in progress is finished first
+     */
     Iterator begin() {
+        finishRehash();
         if (firstBucketIt != buckets.end()) {
             return Iterator(this, firstBucketIt, firstBucketIt->before_begin());
         }
@@ -234,40 +623,44 @@ public:
         return find(key) != end();
     }
 
+    /**
+     * contains for any type accepted by transparent Hash and KeyEqual
+     */
+    template<typename K, typename = EnableTransparent<K>>
+    bool contains(const K &key) {
+        return findKey(key) != end();
+    }
+
     /**
      * Find the value in hashtable by key
      * If the key exists, iterator points to the corresponding value, and it.endFlag = false
      * Otherwise, iterator points to the place that the key were to be inserted, and it.endFlag = true
+     * During an incremental rehash, the old bucket of the key is moved first, so the key is always in buckets;
+     * the nodes moved by later finds are added behind the nodes already in a bucket, so the iterator stays
+     * valid for insert until the hashtable is written to
      * Time Complexity: Amortized O(k)
      * @param key
      * @return a pair (success, iterator of the value)
      */
     Iterator find(const Key &key) {
-        Iterator found(this);        
-        found.bucketIt = buckets.begin() + hashKey(key);
-        found.listItBefore = found.bucketIt->before_begin();
-        found.endFlag = true;
-        //if empty, return found directly
-        if(found.bucketIt->empty()) return found;
-
-        while(found.bucketIt==buckets.begin() + hashKey(key)&& !keyEqual(found->first, key)) found++;
-
-        if(found.bucketIt == buckets.begin() + hashKey(key)) found.endFlag = false;
-        else {
-            found.bucketIt =  buckets.begin() + hashKey(key);
-            found.listItBefore = found.bucketIt->before_begin();
-        }; //if found != it, then we know that there is no element equals Key
-                    
-        return found;
+        return findKey(key);
         // TODO: implement this functions
     }
 
+    /**
+     * find for any type accepted by transparent Hash and KeyEqual
+     */
+    template<typename K, typename = EnableTransparent<K>>
+    Iterator find(const K &key) {
+        return findKey(key);
+    }
+
     /**
      * Insert value into the hashtable according to an iterator returned by find
      * the function can be only be called if no other write actions are done to the hashtable after the find
      * If the key already exists, overwrite its value
      * firstBucketIt should be updated
-     * If load factor exceeds maximum value, rehash the hashtable
+     * If load factor exceeds maximum value, rehash the hashtable (incrementally if enabled)
      * Time Complexity: O(k)
      * @param it an iterator returned by find
      * @param key
@@ -277,18 +670,25 @@ public:
     bool insert(const Iterator &it, const Key &key, const Value &value) {
         // TODO: implement this function
         if (it.endFlag){
-            it.bucketIt->insert_after(it.listItBefore, HashNode(key, value));
+            emplaceAt(it, key, value);
+            return true;
+        }
+        else{
+            std::next(it.listItBefore)->node.second = value;
+            return false;
+        }
+    }
 
-            if (firstBucketIt == buckets.end()) firstBucketIt = it.bucketIt;           //if firstBucketIt haven't been initialized, initialize it
-            else if(it.bucketIt < firstBucketIt) firstBucketIt = it.bucketIt; //if firstBucketIt is larger than it.bucketIt, replace it with it.bucketIt
-            ++tableSize;
-            if (maxLoadFactor < loadFactor()) 
-                rehash(buckets.size());
+    /**
+     * insert that moves key and value into the hashtable instead of copying them
+     */
+    bool insert(const Iterator &it, Key &&key, Value &&value) {
+        if (it.endFlag){
+            emplaceAt(it, std::move(key), std::move(value));
             return true;
         }
         else{
-            typename HashNodeList::iterator temp = it.listItBefore;
-            (++temp)->second = value;
+            std::next(it.listItBefore)->node.second = std::move(value);
             return false;
         }
     }
@@ -308,44 +708,234 @@ public:
         // TODO: implement this function
     }
 
+    /**
+     * insert that moves key and value into the hashtable instead of copying them
+     */
+    bool insert(Key &&key, Value &&value) {
+        Iterator it = find(key);
+        return insert(it, std::move(key), std::move(value));
+    }
+
+    /**
+     * Find the node of key without changing anything in the hashtable, so that any number of threads can call it
+     * at the same time (while no thread writes): an incremental rehash in progress is not advanced,
+     * the old bucket of the key is searched as well, and the lookup is never sampled
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return a pointer to the node of key, or nullptr if the key doesn't exist
+     */
+    const HashNode *lookup(const Key &key) const {
+        size_t hashValue = hash(key);
+        auto search = [this, &key, hashValue](const HashNodeList &bucket) -> const HashNode * {
+            for (const auto &entry : bucket) {
+                if (entry.hashMatches(hashValue) && keyEqual(entry.node.first, key)) return &entry.node;
+            }
+            return nullptr;
+        };
+        //a moved old bucket is empty
+        if (rehashing) {
+            if (const HashNode *node = search(oldBuckets[oldSizePolicy.index(hashValue)])) return node;
+        }
+        return search(buckets[sizePolicy.index(hashValue)]);
+    }
+
+    /**
+     * Find n keys, BATCH at a time: the keys of a block are hashed and their buckets prefetched
+     * before any of them is searched
+     * During an incremental rehash, every key moves its old bucket and MIGRATE_STEP more, as find does
+     * Time Complexity: Amortized O(nk)
+     * @param keys
+     * @param n number of keys
+     * @param out set to the address of the value of each key, or nullptr if the key doesn't exist
+     * @return the number of keys found
+     */
+    size_t findBatch(const Key *keys, size_t n, Value **out) {
+        size_t hashes[BATCH];
+        size_t found = 0;
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            prefetchBlock(keys + start, count, hashes);
+            for (size_t l = 0; l < count; l++) {
+                Iterator it = findHashed(keys[start + l], hashes[l]);
+                out[start + l] = it.endFlag ? nullptr : &it->second;
+                found += !it.endFlag;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Insert n pairs <keys[i], values[i]> in the same way as findBatch
+     * The table grows once per block before the block is prefetched, so no insert in the block rehashes;
+     * with incremental rehash, the keys grow the table as insert does instead, so no block stops for a full rehash
+     * If a key already exists, overwrite its value
+     * Time Complexity: Amortized O(nk)
+     * @return the number of insertions that took place
+     */
+    size_t insertBatch(const Key *keys, const Value *values, size_t n) {
+        size_t hashes[BATCH];
+        size_t inserted = 0;
+        for (size_t start = 0; start < n; start += BATCH) {
+            size_t count = std::min(BATCH, n - start);
+            double needed = (double) (tableSize + count);
+            if (!incremental && maxLoadFactor * (double) buckets.size() < needed) {
+                rehash((size_t) (needed / maxLoadFactor) + 1);
+            }
+            prefetchBlock(keys + start, count, hashes);
+            for (size_t l = 0; l < count; l++) {
+                Iterator it = findHashed(keys[start + l], hashes[l]);
+                inserted += insert(it, keys[start + l], values[start + l]);
+            }
+        }
+        return inserted;
+    }
+
+    /**
+     * Make room for n elements, so that no insert rehashes until the size exceeds n
+     * Never shrinks the hashtable
+     * Time Complexity: O(nk) if it rehashes, otherwise O(1)
+     * @param n
+     */
+    void reserve(size_t n) {
+        size_t needed = (size_t) ((double) n / maxLoadFactor) + 1;
+        if (needed > buckets.size()) rehash(needed);
+    }
+
+    /**
+     * Insert the pairs (key, value) in [first, last), as insert does, later pairs overwrite earlier ones
+     * With forward iterators, the hashtable is sized once for all the pairs, the pairs are hashed
+     * (by threads threads, Hash must then be safe to call concurrently) and sorted by bucket,
+     * and the nodes are linked one bucket after another, so nodes of a bucket are allocated next to each other
+     * Input iterators are inserted one by one
+     * Time Complexity: O(nk + number of buckets)
+     * @tparam InputIt an iterator of pairs (key, value)
+     * @param threads number of threads hashing the keys
+     * @return the number of insertions that took place
+     */
+    template<typename InputIt>
+    size_t bulkLoad(InputIt first, InputIt last, size_t threads = 1) {
+        typedef typename std::iterator_traits<InputIt>::iterator_category Category;
+        size_t inserted = 0;
+        if constexpr (!std::is_base_of<std::forward_iterator_tag, Category>::value) {
+            for (; first != last; ++first) inserted += insert(first->first, first->second);
+            return inserted;
+        }
+        else {
+            finishRehash();
+            std::vector<InputIt> items;
+            for (; first != last; ++first) items.push_back(first);
+            reserve(tableSize + items.size());
+
+            //hash every key, the only step that does not touch the lists
+            std::vector<size_t> hashes(items.size());
+            auto hashRange = [this, &items, &hashes](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) hashes[i] = hash(items[i]->first);
+            };
+            threads = std::max<size_t>(1, std::min(threads, items.size() / 4096 + 1));
+            std::vector<std::thread> workers;
+            size_t chunk = (items.size() + threads - 1) / threads;
+            for (size_t t = 1; t < threads; t++) {
+                workers.emplace_back(hashRange, std::min(t * chunk, items.size()),
+                                     std::min((t + 1) * chunk, items.size()));
+            }
+            hashRange(0, std::min(chunk, items.size()));
+            for (auto &worker : workers) worker.join();
+
+            //counting sort by bucket, stable so that later pairs still overwrite earlier ones
+            std::vector<size_t> start(buckets.size() + 1, 0);
+            for (size_t h : hashes) ++start[sizePolicy.index(h) + 1];
+            for (size_t b = 0; b < buckets.size(); b++) start[b + 1] += start[b];
+            std::vector<size_t> order(items.size());
+            for (size_t i = 0; i < items.size(); i++) order[start[sizePolicy.index(hashes[i])]++] = i;
+
+            for (size_t i : order) {
+                auto bucketIt = buckets.begin() + sizePolicy.index(hashes[i]);
+                Iterator it = findInBucket(bucketIt, items[i]->first, hashes[i]);
+                inserted += insert(it, items[i]->first, items[i]->second);
+            }
+            return inserted;
+        }
+    }
+
+    /**
+     * Insert a node with key, and the value constructed from args, if the key doesn't exist
+     * Otherwise, do nothing: args are not used and key is not moved from
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param args arguments of a constructor of Value
+     * @return a pair (iterator of the key, whether insertion took place)
+     */
+    template<typename... Args>
+    std::pair<Iterator, bool> tryEmplace(const Key &key, Args &&... args) {
+        return tryEmplaceKey(key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<Iterator, bool> tryEmplace(Key &&key, Args &&... args) {
+        return tryEmplaceKey(std::move(key), std::forward<Args>(args)...);
+    }
+
+    /**
+     * Construct a node from args (as the arguments of a HashNode constructor), insert it if its key doesn't exist
+     * The node is built once, in a list with the same allocator, and spliced into its bucket
+     * Time Complexity: Amortized O(k)
+     * @return a pair (iterator of the key, whether insertion took place)
+     */
+    template<typename... Args>
+    std::pair<Iterator, bool> emplace(Args &&... args) {
+        HashNodeList node(allocator);
+        node.emplace_front(0, std::forward<Args>(args)...);
+        size_t hashValue = hash(node.front().node.first);
+        node.front().setHash(hashValue);
+        Iterator it = findHashed(node.front().node.first, hashValue);
+        if (!it.endFlag) return {it, false};
+        it.bucketIt->splice_after(it.listItBefore, node, node.before_begin());
+        return {linked(it), true};
+    }
+
     /**
      * Erase the key if it exists in the hashtable, otherwise, do nothing
-     * DO NOT rehash in this function
+     * DO NOT rehash in this function, unless the load factor falls below the minimum load factor (0 by default)
      * firstBucketIt should be updated
      * Time Complexity: Amortized O(k)
      * @param key
      * @return whether the key exists
      */
     bool erase(const Key &key) {
-        Iterator it = find(key);
-        if(it.endFlag) return !it.endFlag;
-        erase(it);
-        return !it.endFlag;
+        return eraseKey(key);
         // TODO: implement this function
     }
 
+    /**
+     * erase for any type accepted by transparent Hash and KeyEqual
+     */
+    template<typename K, typename = EnableTransparent<K>>
+    bool erase(const K &key) {
+        return eraseKey(key);
+    }
+
+
     /**
      * Erase the key at the input iterator
      * If the input iterator is the end iterator, do nothing and return the input iterator directly
      * firstBucketIt should be updated
-     * Time Complexity: O(1)
+     * Time Complexity: O(1), plus a scan of the occupancy bitmap if the bucket becomes empty
      * @param it
      * @return the iterator after the input iterator before the erase
      */
     Iterator erase(const Iterator &it) {
-        if(it == end()) return it;
-        if(!it.endFlag) {
-            it.bucketIt->erase_after(it.listItBefore);
-            tableSize--;
-            if(firstBucketIt == it.bucketIt && it.bucketIt->empty()){ //if the smallest forward_list is erased, find the next non-empty list to be the first bucket
-                auto temp = it.bucketIt+1;
-                for(; temp != buckets.end() && temp->empty(); temp++);
-                firstBucketIt = temp;
-            }
-        }
-        
-        return it;
-        // TODO: implement this function
+        if(it.endFlag) return it;
+        it.bucketIt->erase_after(it.listItBefore);
+        tableSize--;
+        //the next node takes the place of the erased one in the list
+        if (std::next(it.listItBefore) != it.bucketIt->end()) return Iterator(this, it.bucketIt, it.listItBefore);
+        size_t index = (size_t) (it.bucketIt - buckets.begin());
+        if (it.bucketIt->empty()) markEmpty(index);
+        auto nextIt = buckets.begin() + (std::ptrdiff_t) nextOccupied(index + 1);
+        //if the smallest forward_list is erased, the next non-empty list is the first bucket
+        if (firstBucketIt == it.bucketIt && it.bucketIt->empty()) firstBucketIt = nextIt;
+        if (nextIt == buckets.end()) return end();
+        return Iterator(this, nextIt, nextIt->before_begin());
     }
 
     /**
@@ -358,54 +948,85 @@ public:
      * @return reference of value
      */
     Value &operator[](const Key &key) {
-        Iterator it = find(key);
-        if(it.endFlag){
-            insert(it, key, Value());
-            it = find(key);
-        }
-        return it->second;
+        return tryEmplace(key).first->second;
         // TODO: implement this function
     }
 
+    /**
+     * operator[] that moves key into the hashtable if it doesn't exist
+     */
+    Value &operator[](Key &&key) {
+        return tryEmplace(std::move(key)).first->second;
+    }
+
     /**
      * Rehash the hashtable according to the (hinted) number of buckets
      * The bucket size after rehash need not be same as the parameter bucketSize
      * Instead, findMinimumBucketSize is called to get the correct number
      * firstBucketIt should be updated
      * Do nothing if the bucketSize doesn't change
+     * The nodes are moved into a new bucket vector with splice_after, so no node is allocated or copied
+     * An incremental rehash in progress is finished first
      * Time Complexity: O(nk)
-     * 
-     * bucketIt = hashTable->buckets.begin();
-            listItBefore
      * @param bucketSize lower bound of the new number of buckets
      */
     void rehash(size_t bucketSize) {
+        finishRehash();
         bucketSize = findMinimumBucketSize(bucketSize);
         if (bucketSize == buckets.size()) return;
-        buckets.resize(bucketSize);
-        
-        //refresh firstBucketIt
-        auto it1 = buckets.begin();
-        for(; it1 != buckets.end()&&it1->empty(); it1++);
-        firstBucketIt = it1;
-
-        //rehash
-        for(auto temp = buckets.begin(); temp!=buckets.end(); temp++){
-            auto it = temp->before_begin();
-            while(next(it)!=temp->end()){
-                auto value = *next(it);
-                if(buckets.begin()+hashKey(value.first) == temp){
-                    it++;
-                    continue;
-                }//no need to modify
-                Iterator temp2(this,temp,it);
-                erase(temp2);
-                insert(value.first, value.second);
+        RehashTimer timer(*this);
+        ++rehashCount;
+
+        HashTableData oldData;
+        std::vector<uint64_t> oldOccupancy;
+        oldData.swap(buckets);
+        oldOccupancy.swap(occupancy);
+        resizeBuckets(bucketSize);
+        //only the non-empty old buckets are visited
+        for (size_t word = 0; word < oldOccupancy.size(); word++) {
+            for (uint64_t bits = oldOccupancy[word]; bits; bits &= bits - 1) {
+                auto &bucket = oldData[word * 64 + (size_t) __builtin_ctzll(bits)];
+                while (!bucket.empty()) {
+                    size_t index = sizePolicy.index(bucket.front().getHash(hash));
+                    buckets[index].splice_after(buckets[index].before_begin(), bucket, bucket.before_begin());
+                    markOccupied(index);
+                }
             }
         }
-        // TODO: implement this function
+
+        //refresh firstBucketIt
+        firstBucketIt = buckets.begin() + (std::ptrdiff_t) nextOccupied(0);
+    }
+
+    /**
+     * Rehash to the fewest buckets that keep the load factor under the maximum load factor
+     * Nodes freed by erase stay in the node pool, only the bucket vector shrinks
+     * Time Complexity: O(nk)
+     */
+    void shrinkToFit() {
+        rehash(0);
+    }
+
+    /**
+     * Erase every element, the number of buckets is kept
+     * After the nodes are destroyed, the node pool gives all its memory back at once
+     * Time Complexity: O(n + number of buckets)
+     */
+    void clear() {
+        for (auto &bucket : buckets) bucket.clear();
+        std::fill(occupancy.begin(), occupancy.end(), 0);
+        HashTableData().swap(oldBuckets);
+        rehashing = false;
+        tableSize = 0;
+        firstBucketIt = buckets.end();
+        releaseNodes(allocator);
     }
 
+    /**
+     * @return the allocator of the nodes
+     */
+    const Allocator &getAllocator() const { return allocator; }
+
     /**
      * @return the number of elements in the hashtable
      */
@@ -428,17 +1049,121 @@ public:
 
     /**
      * Set the max load factor
-     * @throw std::range_error if the load factor is too small
+     * @throw std::range_error if the load factor is too small, or not 4 times the minimum load factor
      * @param loadFactor
      */
     void setMaxLoadFactor(double loadFactor) {
-        if (loadFactor <= 1e-9) {
+        if (loadFactor <= 1e-9 || loadFactor < 4 * minLoadFactor) {
             throw std::range_error("invalid load factor!");
         }
         maxLoadFactor = loadFactor;
         rehash(buckets.size());
     }
 
+    /**
+     * @return the minimum load factor of the hashtable
+     */
+    double getMinLoadFactor() const { return minLoadFactor; }
+
+    /**
+     * Set the min load factor: when an erase by key leaves the load factor below it, the hashtable shrinks
+     * to a load factor of at most half the maximum, stepping down the sizes of SizePolicy
+     * The gap between the two (at least a factor of 4) keeps inserts and erases around one size from
+     * growing and shrinking over and over
+     * 0 (the default) disables shrinking; erase by iterator never shrinks, so erasing while iterating is safe
+     * @throw std::range_error if the load factor is negative, or more than a quarter of the maximum load factor
+     * @param loadFactor
+     */
+    void setMinLoadFactor(double loadFactor) {
+        if (loadFactor < 0 || 4 * loadFactor > maxLoadFactor) {
+            throw std::range_error("invalid load factor!");
+        }
+        minLoadFactor = loadFactor;
+    }
+
+    /**
+     * Enable or disable incremental rehash
+     * When enabled, an insert that exceeds the maximum load factor only allocates the new buckets,
+     * and every later find (so every insert, erase and operator[]) moves the key's old bucket and
+     * MIGRATE_STEP more, like the dict of Redis. No single operation then costs O(n)
+     * Disabling it finishes a rehash in progress
+     * @param enable
+     */
+    void setIncrementalRehash(bool enable) {
+        incremental = enable;
+        if (!enable) finishRehash();
+    }
+
+    /**
+     * @return whether an incremental rehash is in progress
+     */
+    bool isRehashing() const { return rehashing; }
+
+    /**
+     * Measure the chains of the hashtable, to spot a bad hash function or tune the maximum load factor
+     * During an incremental rehash, the old buckets not moved yet are measured as well
+     * Bytes per entry counts the bucket vectors and a list node (its link and an Entry) per element,
+     * not the blocks kept free by the allocator
+     * Time Complexity: O(n + number of buckets)
+     * @return the statistics
+     */
+    Stats stats() const {
+        Stats result;
+        size_t found = 0;           // comparisons to find every key once
+        size_t nodes = 0;
+        auto measure = [this, &result, &found, &nodes](const HashNodeList &bucket) {
+            size_t length = 0;
+            std::map<size_t, size_t> sameHash;      // with StoreHash, nodes of each hash value seen so far
+            for (const auto &entry : bucket) {
+                //a node is reached after the KeyEqual calls on every node before it (with the same hash value)
+                size_t comparisons = ++length;
+                if (StoreHash) comparisons = ++sameHash[entry.getHash(hash)];
+                found += comparisons;
+                result.maxSuccessfulComparisons = std::max(result.maxSuccessfulComparisons, comparisons);
+            }
+            if (result.chainLengths.size() <= length) result.chainLengths.resize(length + 1, 0);
+            ++result.chainLengths[length];
+            nodes += length;
+            result.maxUnsuccessfulComparisons = std::max(result.maxUnsuccessfulComparisons, length);
+        };
+        for (const auto &bucket : buckets) measure(bucket);
+        if (rehashing) {
+            for (size_t i = migrated; i < oldBuckets.size(); i++) measure(oldBuckets[i]);
+        }
+
+        size_t bucketCount = buckets.size() + (rehashing ? oldBuckets.size() : 0);
+        if (nodes) result.successfulComparisons = (double) found / (double) nodes;
+        result.unsuccessfulComparisons = (double) nodes / (double) bucketCount;
+        result.rehashCount = rehashCount;
+        result.rehashSeconds = rehashSeconds;
+        const size_t nodeBytes = sizeof(void *) + sizeof(Entry);
+        size_t bytes = bucketCount * sizeof(HashNodeList) + occupancy.size() * sizeof(uint64_t) + nodes * nodeBytes;
+        if (nodes) result.bytesPerEntry = (double) bytes / (double) nodes;
+        result.sampledLookups = sampledLookups;
+        result.sampledKeyEqualCalls = sampledKeyEqualCalls;
+        return result;
+    }
+
+    /**
+     * Count the KeyEqual calls of one lookup (find, insert, erase, ...) in every, to be read by stats
+     * A sampled lookup walks its bucket twice, the other lookups only pay for a counter
+     * @param every sample one lookup in every, 0 to stop sampling
+     */
+    void setLookupSampling(size_t every) {
+        sampleEvery = every;
+        sampleTick = 0;
+    }
+
+    /**
+     * Reset the rehash and sampling counters of stats
+     */
+    void resetStats() {
+        rehashCount = 0;
+        rehashSeconds = 0;
+        sampledLookups = 0;
+        sampledKeyEqualCalls = 0;
+    }
+
     /*
     friend std::ostream& operator<<(std::ostream& out, HashTable<Key, Value>& hash){
         size_t temp = hash.hashKey(hash.begin()->first);
@@ -458,3 +1183,4 @@ public:
     
 };
 
+#endif //VE281P2_HASHTABLE_HPP
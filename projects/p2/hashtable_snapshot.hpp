@@ -0,0 +1,332 @@
+#ifndef VE281P2_HASHTABLE_SNAPSHOT_HPP
+#define VE281P2_HASHTABLE_SNAPSHOT_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * A read-only image of a hashtable in a file, for tables that are too large to rebuild at every start
+ * write stores any of the hashtables (HashTable, FlatHashTable, ...) as a flat open addressing table, built
+ * directly in the mapped output file; the constructor maps the file into memory and only checks the header,
+ * so opening takes the same time whatever the size, and pages are read from the file as lookups touch them
+ * File layout, every part starting on a cache line:
+ * - Header: magic, version, layout of Key and Value, number of slots and elements, checksums
+ * - Control bytes: one per slot, 0 if empty, otherwise 7 bits of the hash of its key with the high bit set
+ * - Slots: {Key, Value} with linear probing over a power of 2 number of slots
+ * The file is only readable by the same build: Hash must give the same values in every process
+ * (std::hash does for integers), and the byte order and layout are those of the machine that wrote it
+ * The time complexity of functions are based on k, the length of Key
+ * @tparam Key          key type, trivially copyable
+ * @tparam Value        data type, trivially copyable
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>
+>
+class HashTableSnapshot {
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "a snapshot stores keys and values as raw bytes");
+
+public:
+    struct Slot {
+        Key key;
+        Value value;
+    };
+
+protected:
+    static constexpr uint64_t MAGIC = 0x3130325045534856ull;   // "VHSEP201" in little endian
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGN = 64;
+    static constexpr double LOAD_FACTOR = 0.7;                  // load factor of the image
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t slotBytes;             // sizeof(Slot)
+        uint32_t keyBytes;              // sizeof(Key)
+        uint32_t valueBytes;            // sizeof(Value)
+        uint64_t slotCount;             // number of slots, a power of 2
+        uint64_t size;                  // number of elements
+        uint64_t controlOffset;         // byte offset of the control bytes
+        uint64_t slotOffset;            // byte offset of the slots
+        uint64_t fileBytes;             // total length of the file
+        uint64_t dataChecksum;          // checksum of the control bytes and the slots
+        uint64_t headerChecksum;        // checksum of the fields above
+    };
+
+    static constexpr size_t alignUp(size_t n) { return (n + ALIGN - 1) / ALIGN * ALIGN; }
+
+    static size_t mix(size_t h) {
+        uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return (size_t) x;
+    }
+
+    static uint8_t controlOf(size_t h) { return (uint8_t) (0x80u | (h >> 57)); }
+
+    /**
+     * A checksum that reads 8 bytes at a time
+     */
+    static uint64_t checksum(const unsigned char *data, size_t bytes) {
+        uint64_t sum = 0x9e3779b97f4a7c15ull ^ bytes;
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            sum = (sum ^ word) * 0xff51afd7ed558ccdull;
+            sum ^= sum >> 32;
+        }
+        for (; i < bytes; i++) sum = (sum ^ data[i]) * 0x100000001b3ull;
+        return sum;
+    }
+
+    static uint64_t headerChecksum(const Header &header) {
+        return checksum(reinterpret_cast<const unsigned char *>(&header), offsetof(Header, headerChecksum));
+    }
+
+    static std::runtime_error systemError(const std::string &what, const std::string &path) {
+        return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+    }
+
+    const unsigned char *image = nullptr;       // the mapped file
+    size_t imageBytes = 0;
+    const Header *header = nullptr;
+    const uint8_t *control = nullptr;
+    const Slot *slots = nullptr;
+    size_t mask = 0;                            // slotCount - 1
+    Hash hash;                                  // hash function instance
+    KeyEqual keyEqual;                          // key equal function instance
+
+    /**
+     * Whether the control bytes and the slots of the header lie in order inside a file of the given length,
+     * the slots aligned and ending the file, with a power of 2 number of slots, not all of them used
+     * Every comparison is written so that no sum or product can overflow
+     */
+    static bool validLayout(const Header &head, size_t bytes) {
+        uint64_t count = head.slotCount;
+        if (count == 0 || (count & (count - 1)) != 0 || head.size >= count) return false;
+        if (head.controlOffset < sizeof(Header) || head.controlOffset > bytes) return false;
+        if (count > head.slotOffset || head.controlOffset > head.slotOffset - count) return false;
+        if (head.slotOffset % ALIGN != 0 || head.slotOffset > bytes) return false;
+        return count <= (bytes - head.slotOffset) / sizeof(Slot) &&
+               head.slotOffset + count * sizeof(Slot) == head.fileBytes;
+    }
+
+    void unmap() {
+        if (image) munmap(const_cast<unsigned char *>(image), imageBytes);
+        image = nullptr;
+    }
+
+public:
+    /**
+     * Write a hashtable to a file, replacing it if it exists
+     * The image is built in a temporary file next to path, mapped into memory, then synced and renamed over path:
+     * processes that mapped the old file keep reading it, and a crash leaves either the old or the new file
+     * Time Complexity: O(nk)
+     * @throw std::runtime_error if the file cannot be written
+     * @tparam Table any hashtable with begin, end and size, whose elements are pairs of Key and Value
+     * @param path
+     * @param table
+     */
+    template<typename Table>
+    static void write(const std::string &path, Table &table) {
+        Header head{};
+        head.magic = MAGIC;
+        head.version = VERSION;
+        head.slotBytes = sizeof(Slot);
+        head.keyBytes = sizeof(Key);
+        head.valueBytes = sizeof(Value);
+        head.size = table.size();
+        head.slotCount = 16;
+        while ((double) head.size > LOAD_FACTOR * (double) head.slotCount) head.slotCount <<= 1;
+        head.controlOffset = alignUp(sizeof(Header));
+        head.slotOffset = alignUp(head.controlOffset + head.slotCount);
+        head.fileBytes = head.slotOffset + head.slotCount * sizeof(Slot);
+
+        std::string temporary = path + ".XXXXXX";
+        int fd = ::mkstemp(&temporary[0]);
+        if (fd < 0) throw systemError("cannot create", path);
+        void *mapped = MAP_FAILED;
+        auto fail = [&](const char *what) {
+            std::runtime_error error = systemError(what, temporary);
+            if (mapped != MAP_FAILED) ::munmap(mapped, head.fileBytes);
+            ::close(fd);
+            ::unlink(temporary.c_str());
+            return error;
+        };
+        //the new file is zero filled, so every control byte starts empty; allocating its blocks now turns
+        //a full disk into an error here instead of a SIGBUS while writing through the mapping
+        if (::fchmod(fd, 0644) != 0 || ::ftruncate(fd, (off_t) head.fileBytes) != 0) throw fail("cannot write");
+        if ((errno = ::posix_fallocate(fd, 0, (off_t) head.fileBytes)) != 0) throw fail("cannot write");
+        mapped = ::mmap(nullptr, head.fileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) throw fail("cannot map");
+
+        //placing needs random access, the pages of the mapping are written back by the kernel
+        unsigned char *out = static_cast<unsigned char *>(mapped);
+        uint8_t *ctrl = out + head.controlOffset;
+        unsigned char *data = out + head.slotOffset;
+        Hash hash;
+        size_t mask = head.slotCount - 1;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            size_t h = mix(hash(it->first));
+            size_t index = h & mask;
+            while (ctrl[index]) index = (index + 1) & mask;
+            ctrl[index] = controlOf(h);
+            Slot slot{it->first, it->second};
+            std::memcpy(data + index * sizeof(Slot), &slot, sizeof(Slot));
+        }
+        head.dataChecksum = checksum(out + head.controlOffset, head.fileBytes - head.controlOffset);
+        head.headerChecksum = headerChecksum(head);
+        std::memcpy(out, &head, sizeof(Header));
+
+        if (::msync(mapped, head.fileBytes, MS_SYNC) != 0) throw fail("cannot write");
+        ::munmap(mapped, head.fileBytes);
+        mapped = MAP_FAILED;
+        if (::fsync(fd) != 0) throw fail("cannot write");
+        if (::close(fd) != 0) {
+            ::unlink(temporary.c_str());
+            throw systemError("cannot write", temporary);
+        }
+        if (::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::runtime_error error = systemError("cannot replace", path);
+            ::unlink(temporary.c_str());
+            throw error;
+        }
+        //make the rename itself durable, some file systems cannot sync a directory, which is not an error
+        size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirFd >= 0) {
+            ::fsync(dirFd);
+            ::close(dirFd);
+        }
+    }
+
+    /**
+     * Map a snapshot file, only its header is read
+     * Every offset and count of the header is checked against the length of the file, so a damaged header is
+     * rejected here, and a damaged body at worst gives wrong answers (verify detects it)
+     * Time Complexity: O(1)
+     * @throw std::runtime_error if the file cannot be mapped, or is not a snapshot of this Key and Value
+     * @param path
+     */
+    explicit HashTableSnapshot(const std::string &path) : hash(Hash()), keyEqual(KeyEqual()) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw systemError("cannot open", path);
+        struct stat status{};
+        if (::fstat(fd, &status) != 0) {
+            std::runtime_error error = systemError("cannot open", path);
+            ::close(fd);
+            throw error;
+        }
+        imageBytes = (size_t) status.st_size;
+        if (imageBytes < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("not a hashtable snapshot: " + path);
+        }
+        void *mapped = ::mmap(nullptr, imageBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) throw systemError("cannot map", path);
+        image = static_cast<const unsigned char *>(mapped);
+
+        header = reinterpret_cast<const Header *>(image);
+        if (header->magic != MAGIC || header->headerChecksum != headerChecksum(*header) ||
+            header->version != VERSION || header->fileBytes != imageBytes) {
+            unmap();
+            throw std::runtime_error("not a hashtable snapshot: " + path);
+        }
+        if (header->slotBytes != sizeof(Slot) || header->keyBytes != sizeof(Key) ||
+            header->valueBytes != sizeof(Value)) {
+            unmap();
+            throw std::runtime_error("snapshot of another key or value type: " + path);
+        }
+        if (!validLayout(*header, imageBytes)) {
+            unmap();
+            throw std::runtime_error("damaged hashtable snapshot: " + path);
+        }
+        control = image + header->controlOffset;
+        slots = reinterpret_cast<const Slot *>(image + header->slotOffset);
+        mask = header->slotCount - 1;
+    }
+
+    HashTableSnapshot(const HashTableSnapshot &) = delete;
+
+    HashTableSnapshot &operator=(const HashTableSnapshot &) = delete;
+
+    ~HashTableSnapshot() { unmap(); }
+
+    /**
+     * Find the value in the snapshot by key
+     * Time Complexity: O(k) expected
+     * @param key
+     * @return a pointer to the value, or nullptr if the key doesn't exist
+     */
+    const Value *find(const Key &key) const {
+        size_t h = mix(hash(key));
+        uint8_t expected = controlOf(h);
+        //at most one round, in case a damaged file has no empty slot
+        for (size_t index = h & mask, probes = 0; probes <= mask && control[index]; index = (index + 1) & mask) {
+            if (control[index] == expected && keyEqual(slots[index].key, key)) return &slots[index].value;
+            probes++;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Time Complexity: O(k) expected
+     * @param key
+     * @return whether the key exists in the snapshot
+     */
+    bool contains(const Key &key) const { return find(key) != nullptr; }
+
+    /**
+     * Call function on every element, in slot order
+     * Time Complexity: O(number of slots)
+     * @param function called as function(const Key &, const Value &)
+     */
+    template<typename Function>
+    void forEach(Function function) const {
+        for (size_t i = 0; i <= mask; i++) {
+            if (control[i]) function(slots[i].key, slots[i].value);
+        }
+    }
+
+    /**
+     * Check the checksum of the control bytes and the slots, which the constructor skips
+     * Reads the whole file
+     * Time Complexity: O(size of the file)
+     * @return whether the data is intact
+     */
+    bool verify() const {
+        return checksum(image + header->controlOffset, imageBytes - header->controlOffset) == header->dataChecksum;
+    }
+
+    /**
+     * @return the number of elements in the snapshot
+     */
+    size_t size() const { return header->size; }
+
+    /**
+     * @return the number of slots in the snapshot
+     */
+    size_t bucketSize() const { return header->slotCount; }
+};
+
+#endif //VE281P2_HASHTABLE_SNAPSHOT_HPP
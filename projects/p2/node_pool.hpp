@@ -0,0 +1,218 @@
+#ifndef VE281P2_NODE_POOL_HPP
+#define VE281P2_NODE_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A pool of fixed size blocks, cut from slabs that double in size
+ * Freed blocks are kept in a free list and handed out again first, so a table under insert/erase churn
+ * stops calling operator new, and nodes allocated together stay next to each other in memory
+ * The block size and alignment are set by the first allocation, other blocks go to operator new
+ * Not thread safe, like HashTable
+ */
+class NodePool {
+protected:
+    static constexpr size_t MIN_SLAB_BLOCKS = 64;           // blocks in the first slab
+    static constexpr size_t MAX_SLAB_BLOCKS = 1 << 16;      // slabs stop doubling at this size
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    size_t blockSize = 0;                   // bytes per block, 0 before the first allocation
+    size_t blockAlign = alignof(std::max_align_t);
+    size_t slabBlocks = MIN_SLAB_BLOCKS;    // blocks in the next slab
+    std::vector<char *> slabs;
+    char *cursor = nullptr;                 // the next unused block of the last slab
+    char *slabEnd = nullptr;
+    FreeBlock *freeList = nullptr;
+    size_t liveBlocks = 0;
+
+    /**
+     * operator new for any alignment, the aligned overload is only used beyond the default alignment
+     */
+    static void *newBytes(size_t bytes, size_t align) {
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(bytes, std::align_val_t(align));
+        return ::operator new(bytes);
+    }
+
+    static void deleteBytes(void *p, size_t align) {
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(p, std::align_val_t(align));
+        else ::operator delete(p);
+    }
+
+    void newSlab() {
+        char *slab = static_cast<char *>(newBytes(slabBlocks * blockSize, blockAlign));
+        slabs.push_back(slab);
+        cursor = slab;
+        slabEnd = slab + slabBlocks * blockSize;
+        slabBlocks = std::min(2 * slabBlocks, MAX_SLAB_BLOCKS);
+    }
+
+    bool fits(size_t size, size_t align) const { return size <= blockSize && align <= blockAlign; }
+
+public:
+    NodePool() = default;
+
+    NodePool(const NodePool &) = delete;
+
+    NodePool &operator=(const NodePool &) = delete;
+
+    ~NodePool() { release(); }
+
+    /**
+     * Time Complexity: Amortized O(1)
+     * @param size bytes
+     * @param align alignment of the block, a power of 2
+     */
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        if (blockSize == 0) {
+            //a free block stores a pointer, and blocks stay aligned when placed back to back
+            blockAlign = std::max(align, alignof(std::max_align_t));
+            blockSize = (std::max(size, sizeof(FreeBlock)) + blockAlign - 1) / blockAlign * blockAlign;
+        }
+        if (!fits(size, align)) return newBytes(size, align);
+        ++liveBlocks;
+        if (freeList) {
+            FreeBlock *block = freeList;
+            freeList = block->next;
+            return block;
+        }
+        if (cursor == slabEnd) newSlab();
+        void *block = cursor;
+        cursor += blockSize;
+        return block;
+    }
+
+    /**
+     * Time Complexity: O(1)
+     * @param p
+     * @param size the size passed to allocate
+     * @param align the alignment passed to allocate
+     */
+    void deallocate(void *p, size_t size, size_t align = alignof(std::max_align_t)) {
+        if (!fits(size, align)) {
+            deleteBytes(p, align);
+            return;
+        }
+        --liveBlocks;
+        freeList = new(p) FreeBlock{freeList};
+    }
+
+    /**
+     * Give every slab back to the system at once
+     * Only takes place when no block is in use, otherwise does nothing
+     * Time Complexity: O(number of slabs)
+     * @return whether the slabs are released
+     */
+    bool release() {
+        if (liveBlocks != 0) return false;
+        for (char *slab : slabs) deleteBytes(slab, blockAlign);
+        slabs.clear();
+        cursor = slabEnd = nullptr;
+        freeList = nullptr;
+        slabBlocks = MIN_SLAB_BLOCKS;
+        return true;
+    }
+
+    /**
+     * @return the number of bytes held in slabs
+     */
+    size_t capacity() const {
+        size_t bytes = 0;
+        for (size_t i = 0, blocks = MIN_SLAB_BLOCKS; i < slabs.size(); i++) {
+            bytes += blocks * blockSize;
+            blocks = std::min(2 * blocks, MAX_SLAB_BLOCKS);
+        }
+        return bytes;
+    }
+};
+
+/**
+ * The default node allocator of HashTable
+ * It only holds a pointer to a NodePool owned by the table (see NodeStorage), so a bucket list stays small
+ * and copying it costs nothing; every copy (and rebind) of an allocator uses the same pool, so all the buckets
+ * of a table, which are spliced into each other, draw from the same slabs
+ * A default constructed allocator has no pool and uses operator new, so does a copied container
+ * @tparam T the type allocated
+ */
+template<typename T>
+class NodePoolAllocator {
+    template<typename U> friend class NodePoolAllocator;
+
+    NodePool *pool = nullptr;
+
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    NodePoolAllocator() = default;
+
+    explicit NodePoolAllocator(NodePool *pool) noexcept : pool(pool) {}
+
+    template<typename U>
+    NodePoolAllocator(const NodePoolAllocator<U> &that) noexcept : pool(that.pool) {}
+
+    T *allocate(size_t n) {
+        if (n != 1 || !pool) return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T *>(pool->allocate(sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (n != 1 || !pool) ::operator delete(p, std::align_val_t(alignof(T)));
+        else pool->deallocate(p, sizeof(T), alignof(T));
+    }
+
+    NodePoolAllocator select_on_container_copy_construction() const { return NodePoolAllocator(); }
+
+    /**
+     * Free the slabs of the pool if no node is alive
+     */
+    bool release() { return pool && pool->release(); }
+
+    const NodePool &getPool() const { return *pool; }
+
+    template<typename U>
+    bool operator==(const NodePoolAllocator<U> &that) const { return pool == that.pool; }
+
+    template<typename U>
+    bool operator!=(const NodePoolAllocator<U> &that) const { return pool != that.pool; }
+};
+
+/**
+ * What a HashTable keeps for its node allocator: nothing for a stateless allocator
+ * @tparam Allocator
+ */
+template<typename Allocator>
+struct NodeStorage {
+    Allocator allocator() { return Allocator(); }
+};
+
+/**
+ * and the NodePool of a NodePoolAllocator, on the heap so that its address never changes
+ */
+template<typename T>
+struct NodeStorage<NodePoolAllocator<T>> {
+    std::unique_ptr<NodePool> pool = std::unique_ptr<NodePool>(new NodePool());
+
+    NodePoolAllocator<T> allocator() { return NodePoolAllocator<T>(pool.get()); }
+};
+
+/**
+ * Bulk release for allocators that support it, nothing for the others
+ */
+template<typename Allocator>
+inline bool releaseNodes(Allocator &) { return false; }
+
+template<typename T>
+inline bool releaseNodes(NodePoolAllocator<T> &allocator) { return allocator.release(); }
+
+#endif //VE281P2_NODE_POOL_HPP
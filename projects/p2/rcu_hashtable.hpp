@@ -0,0 +1,269 @@
+#ifndef VE281P2_RCU_HASHTABLE_HPP
+#define VE281P2_RCU_HASHTABLE_HPP
+
+#include "epoch.hpp"
+#include "hashtable.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * A hashtable for data that is read all the time by many threads and written rarely (read-copy-update)
+ * Readers use the current HashTable (hashtable.hpp) through a pointer, without any lock, so they never wait
+ * for a writer; a thread that reads often registers a Reader, whose lookups are one pointer load and
+ * HashTable::lookup, with no store and no fence, and calls Reader::quiescent between batches of lookups
+ * (quiescent-state-based reclamation, epoch.hpp); the other functions pin an epoch for each call,
+ * which costs one store and one fence
+ * A writer never changes a published table: it builds a new one (or a modified copy of the current one),
+ * publishes it with one pointer store, and retires the old one, deleted once every Reader has been quiescent
+ * and every pinned reader still on it has left
+ * Writers are serialized by a mutex; each write copies the table, so group changes in one update
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ * @tparam SizePolicy   possible numbers of buckets and the map from a hash value to a bucket (hash_prime.hpp)
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>,
+        typename SizePolicy = HashPrime::PrimeSizePolicy
+>
+class RcuHashTable {
+public:
+    typedef HashTable<Key, Value, Hash, KeyEqual, SizePolicy> Table;
+
+protected:
+    std::atomic<const Table *> table;           // the published table
+    std::mutex writerMutex;                     // one writer at a time
+    mutable QuiescentStateManager readers;      // the registered Readers
+    mutable EpochManager epoch;                 // the readers that pin an epoch per call, reclaims the tables
+    std::vector<std::pair<uint64_t, const Table *>> waiting;   // replaced tables a Reader may use, with their version
+
+    /**
+     * Retire the waiting tables that every Reader has passed, the pinned readers may still use them
+     * writerMutex must be held
+     */
+    void passWaiting() {
+        uint64_t minimum = readers.minimumSeen();
+        auto it = std::partition(waiting.begin(), waiting.end(),
+                                 [minimum](const std::pair<uint64_t, const Table *> &w) { return w.first >= minimum; });
+        for (auto passed = it; passed != waiting.end(); ++passed) epoch.retire(const_cast<Table *>(passed->second));
+        waiting.erase(it, waiting.end());
+    }
+
+    /**
+     * Publish a table and retire the one it replaces, writerMutex must be held
+     */
+    void replace(const Table *replacement) {
+        const Table *old = table.exchange(replacement, std::memory_order_acq_rel);
+        waiting.push_back({readers.advance(), old});
+        passWaiting();
+    }
+
+public:
+    RcuHashTable() : table(new Table()) {}
+
+    /**
+     * Start from a copy of a table
+     */
+    explicit RcuHashTable(const Table &initial) : table(new Table(initial)) {}
+
+    RcuHashTable(const RcuHashTable &) = delete;
+
+    RcuHashTable &operator=(const RcuHashTable &) = delete;
+
+    /**
+     * No other thread may use the hashtable any more, every Reader is destroyed
+     */
+    ~RcuHashTable() {
+        delete table.load();
+        for (auto &w : waiting) delete w.second;
+    }
+
+    /**
+     * The primary way to read: a registered reader of one thread, online while it is alive
+     * Pointers and references it returns stay valid until its next quiescent or offline call
+     * A Reader that never calls quiescent keeps every table replaced since alive, so call it between batches
+     * of lookups, and go offline before blocking for long
+     * Destroy every Reader before the hashtable
+     */
+    class Reader {
+        const RcuHashTable &hashTable;
+        QuiescentStateManager::Reader state;
+
+    public:
+        /**
+         * @throw std::runtime_error if QuiescentStateManager::MAX_READERS readers are registered
+         */
+        explicit Reader(const RcuHashTable &hashTable) : hashTable(hashTable), state(hashTable.readers) {}
+
+        /**
+         * The published table, valid until the next quiescent or offline call
+         * Time Complexity: O(1)
+         */
+        const Table &current() const { return *hashTable.table.load(std::memory_order_acquire); }
+
+        /**
+         * Find the key in the published table, no store and no fence
+         * Time Complexity: Amortized O(k)
+         * @return the node of key, valid until the next quiescent or offline call, or nullptr
+         */
+        const typename Table::HashNode *lookup(const Key &key) const { return current().lookup(key); }
+
+        /**
+         * Copy the value of key
+         * Time Complexity: Amortized O(k)
+         * @param key
+         * @param value set to the value of key if it exists
+         * @return whether the key exists in the hashtable
+         */
+        bool find(const Key &key, Value &value) const {
+            const auto *node = lookup(key);
+            if (!node) return false;
+            value = node->second;
+            return true;
+        }
+
+        bool contains(const Key &key) const { return lookup(key) != nullptr; }
+
+        /**
+         * Announce that no pointer or reference returned before is used any more
+         * Time Complexity: O(1)
+         */
+        void quiescent() { state.quiescent(); }
+
+        /**
+         * Stop holding back the reclamation, e.g. before waiting; lookups are not allowed until online
+         */
+        void offline() { state.offline(); }
+
+        void online() { state.online(); }
+    };
+
+    /**
+     * Call function with the value of key in the published table, for occasional readers
+     * Wait free: no lock, and the only shared write is to the epoch slot of the thread, followed by a fence;
+     * Reader is cheaper for threads that read often
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param function called as function(const Value &), the value stays valid during the call
+     * @return whether the key exists in the hashtable
+     */
+    template<typename Function>
+    bool visit(const Key &key, Function function) const {
+        EpochManager::Guard guard(epoch);
+        const auto *node = table.load(std::memory_order_acquire)->lookup(key);
+        if (!node) return false;
+        function(node->second);
+        return true;
+    }
+
+    /**
+     * Copy the value of key
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value set to the value of key if it exists
+     * @return whether the key exists in the hashtable
+     */
+    bool find(const Key &key, Value &value) const {
+        return visit(key, [&value](const Value &found) { value = found; });
+    }
+
+    bool contains(const Key &key) const {
+        return visit(key, [](const Value &) {});
+    }
+
+    /**
+     * Call function with the whole published table, e.g. to read several keys from the same version
+     * function must only use the const members of the table, such as lookup, size and stats
+     * Time Complexity: the time of function
+     * @param function called as function(const Table &)
+     */
+    template<typename Function>
+    void read(Function function) const {
+        EpochManager::Guard guard(epoch);
+        function(*table.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Replace the whole table by one built by the caller
+     * Time Complexity: O(1), the old table is deleted later
+     * @param replacement
+     */
+    void publish(std::unique_ptr<Table> replacement) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        replace(replacement.release());
+    }
+
+    /**
+     * Copy the published table, let function change the copy, and publish it
+     * Readers see every change of one update at once
+     * Time Complexity: O(nk) plus the time of function
+     * @param function called as function(Table &)
+     */
+    template<typename Function>
+    void update(Function function) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        std::unique_ptr<Table> copy(new Table(*table.load(std::memory_order_relaxed)));
+        function(*copy);
+        replace(copy.release());
+    }
+
+    /**
+     * Insert <key, value>, overwriting the value if the key already exists
+     * Copies the table, use update for several changes
+     * Time Complexity: O(nk)
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        bool inserted = false;
+        update([&](Table &copy) { inserted = copy.insert(key, value); });
+        return inserted;
+    }
+
+    /**
+     * Erase the key if it exists, otherwise, do nothing (and copy nothing)
+     * Time Complexity: O(nk)
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        const Table *current = table.load(std::memory_order_relaxed);
+        if (!current->lookup(key)) return false;
+        std::unique_ptr<Table> copy(new Table(*current));
+        copy->erase(key);
+        replace(copy.release());
+        return true;
+    }
+
+    /**
+     * @return the number of elements in the published table
+     */
+    size_t size() const {
+        EpochManager::Guard guard(epoch);
+        return table.load(std::memory_order_acquire)->size();
+    }
+
+    /**
+     * Delete the replaced tables that no reader uses any more, without waiting for more retires
+     */
+    void reclaim() {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            passWaiting();
+        }
+        epoch.reclaim();
+    }
+};
+
+#endif //VE281P2_RCU_HASHTABLE_HPP
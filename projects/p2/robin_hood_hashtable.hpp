@@ -0,0 +1,497 @@
+#ifndef VE281P2_ROBIN_HOOD_HASHTABLE_HPP
+#define VE281P2_ROBIN_HOOD_HASHTABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * An open-addressing hashtable with Robin Hood linear probing and the same interface as HashTable (hashtable.hpp)
+ * Every slot stores the probe length of its element, 1 at the home slot of the key and 0 for an empty slot
+ * - An insert takes the slot of any element closer to its home than the new one, and carries that element on,
+ *   so the probe lengths stay short and even, and high load factors (0.9) stay fast
+ * - A lookup stops at the first slot whose element is closer to its home than the key would be,
+ *   so an unsuccessful lookup is as short as a successful one, at most maxProbeLength() + 1 slots
+ * - An erase shifts the following elements back by one slot until one is at its home, so there are no tombstones
+ * The probe sequences do not wrap around: probeLimit extra slots follow the last home slot,
+ * and the table grows if a probe length would exceed probeLimit; keys with the same hash value cannot be
+ * separated by growing, so for them probeLimit is raised instead, up to MAX_PROBE_LIMIT keys of one hash value
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>
+>
+class RobinHoodHashTable {
+public:
+    typedef std::pair<const Key, Value> HashNode;
+
+protected:
+    typedef uint8_t Distance;                   // probe length of the element in a slot, 0 if empty
+    static constexpr size_t MIN_PROBE_LIMIT = 16;
+    static constexpr size_t MAX_PROBE_LIMIT = 255;
+
+public:
+    /**
+     * A single directional iterator for the hashtable
+     */
+    class Iterator {
+    private:
+        const RobinHoodHashTable *hashTable;
+        size_t index;               // slot index, or the slot to insert into for an iterator returned by a failed find
+        bool endFlag = false;       // whether it is an end iterator
+
+        /**
+         * Increment the iterator to the next full slot
+         * Time complexity: Amortized O(1)
+         */
+        void increment() {
+            while (++index < hashTable->slotCount) {
+                if (hashTable->distances[index] != 0) return;
+            }
+            endFlag = true;
+        }
+
+        Iterator(const RobinHoodHashTable *hashTable, size_t index, bool endFlag) :
+                hashTable(hashTable), index(index), endFlag(endFlag) {}
+
+    public:
+        friend class RobinHoodHashTable;
+
+        Iterator() = delete;
+
+        Iterator(const Iterator &) = default;
+
+        Iterator &operator=(const Iterator &) = default;
+
+        Iterator &operator++() {
+            increment();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            increment();
+            return temp;
+        }
+
+        bool operator==(const Iterator &that) const {
+            if (endFlag && that.endFlag) return true;
+            return endFlag == that.endFlag && index == that.index;
+        }
+
+        bool operator!=(const Iterator &that) const {
+            return !(*this == that);
+        }
+
+        HashNode *operator->() {
+            return hashTable->slots + index;
+        }
+
+        HashNode &operator*() {
+            return hashTable->slots[index];
+        }
+    };
+
+protected:
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.9;                      // default maximum load factor is 0.9
+    static constexpr size_t DEFAULT_BUCKET_SIZE = 16;                       // default number of home slots
+
+    Distance *distances = nullptr;              // one probe length per slot
+    HashNode *slots = nullptr;                  // uninitialized storage, only full slots hold a node
+    size_t capacity = 0;                        // number of home slots, a power of 2
+    size_t probeLimit = 0;                      // maximum probe length, also the number of slots after the last home
+    size_t probeFloor = MIN_PROBE_LIMIT;        // lower bound of probeLimit, raised by keys with the same hash value
+    size_t slotCount = 0;                       // capacity + probeLimit
+    size_t maxProbe = 0;                        // the longest probe length since the last rehash
+    size_t tableSize = 0;                       // number of elements
+    double maxLoadFactor;                       // maximum load factor
+    Hash hash;                                  // hash function instance
+    KeyEqual keyEqual;                          // key equal function instance
+
+    /**
+     * Spread the bits of the hash, std::hash is the identity for integers
+     */
+    static size_t mix(size_t h) {
+        uint64_t x = h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return (size_t) x;
+    }
+
+    size_t home(const Key &key) const { return mix(hash(key)) & (capacity - 1); }
+
+    void allocate(size_t newCapacity) {
+        capacity = newCapacity;
+        size_t log = 0;
+        while (((size_t) 1 << log) < capacity) log++;
+        //the longest probe grows with the logarithm of the size at a fixed load factor
+        probeLimit = std::min(MAX_PROBE_LIMIT, std::max(probeFloor, 8 * log));
+        slotCount = capacity + probeLimit;
+        maxProbe = 0;
+        distances = new Distance[slotCount + 1]();  //an empty sentinel after the last slot ends every shift
+        slots = std::allocator<HashNode>().allocate(slotCount);
+    }
+
+    void deallocate() {
+        if (!distances) return;
+        for (size_t i = 0; i < slotCount; i++) {
+            if (distances[i] != 0) slots[i].~HashNode();
+        }
+        std::allocator<HashNode>().deallocate(slots, slotCount);
+        delete[] distances;
+        distances = nullptr;
+        slots = nullptr;
+        capacity = slotCount = 0;
+    }
+
+    /**
+     * Put the carried node into the slot index, at probe length distance, displacing richer elements onward
+     * Time complexity: O(k) per slot passed
+     * @param carried the node to put, empty after success
+     * @return false if an element would pass probeLimit, then carried holds that element and the table is valid
+     */
+    bool place(std::optional<HashNode> &carried, size_t index, size_t distance) {
+        for (;; index++, distance++) {
+            if (distance > probeLimit) return false;
+            if (distances[index] == 0) {
+                new(slots + index) HashNode(std::move(*carried));
+                carried.reset();
+                distances[index] = (Distance) distance;
+                maxProbe = std::max(maxProbe, distance);
+                return true;
+            }
+            if (distances[index] < distance) {
+                //the resident is closer to its home, it gives its slot away and is carried on
+                HashNode resident(std::move(slots[index]));
+                slots[index].~HashNode();
+                new(slots + index) HashNode(std::move(*carried));
+                carried.emplace(std::move(resident));
+                size_t residentDistance = distances[index];
+                distances[index] = (Distance) distance;
+                maxProbe = std::max(maxProbe, distance);
+                distance = residentDistance;
+            }
+        }
+    }
+
+    /**
+     * Time complexity: O(k * probeLimit)
+     * @return the number of elements whose key has the same hash value as key, in the slots key can reach
+     */
+    size_t sameHashCount(const Key &key) const {
+        size_t h = mix(hash(key)), start = h & (capacity - 1), count = 0;
+        for (size_t index = start; index < slotCount && index - start < probeLimit; index++) {
+            if (distances[index] == index - start + 1 && mix(hash(slots[index].first)) == h) count++;
+        }
+        return count;
+    }
+
+    /**
+     * Put a node whose key is not in the hashtable at its home, growing the hashtable until it fits
+     * If the node does not fit because too many keys share its hash value, the probe limit is raised instead
+     * @throw std::range_error if more than MAX_PROBE_LIMIT keys would share a hash value,
+     * then carried still holds the node and the hashtable is valid
+     */
+    void reinsert(std::optional<HashNode> &carried) {
+        while (!place(carried, home(carried->first), 1)) {
+            size_t same = sameHashCount(carried->first) + 1;
+            if (same <= probeLimit) {
+                rehash(capacity * 2);
+                continue;
+            }
+            if (same > MAX_PROBE_LIMIT) throw std::range_error("too many keys with the same hash value!");
+            probeFloor = std::min(MAX_PROBE_LIMIT, std::max(2 * probeFloor, same));
+            rebuild(capacity);
+        }
+    }
+
+    /**
+     * Move every element into new slots, capacity home slots and the probe limit set by allocate
+     * Time Complexity: O(nk)
+     */
+    void rebuild(size_t newCapacity) {
+        Distance *oldDistances = distances;
+        HashNode *oldSlots = slots;
+        size_t oldSlotCount = slotCount;
+        allocate(newCapacity);
+        std::optional<HashNode> carried;
+        for (size_t i = 0; i < oldSlotCount; i++) {
+            if (oldDistances[i] == 0) continue;
+            carried.emplace(std::move(oldSlots[i]));
+            oldSlots[i].~HashNode();
+            reinsert(carried);
+        }
+        std::allocator<HashNode>().deallocate(oldSlots, oldSlotCount);
+        delete[] oldDistances;
+    }
+
+    /**
+     * Find the minimum number of home slots for the hashtable
+     * The minimum bucket size must satisfy all of the following requirements:
+     * - It is not less than (i.e. greater or equal to) the parameter bucketSize
+     * - It is greater than floor(tableSize / maxLoadFactor)
+     * - It is a power of 2 and at least DEFAULT_BUCKET_SIZE
+     * Time Complexity: O(1)
+     * @throw std::range_error if no such bucket size can be found
+     * @param bucketSize lower bound of the new number of slots
+     */
+    size_t findMinimumBucketSize(size_t bucketSize) const {
+        size_t lower = std::max(bucketSize, (size_t) ((double) tableSize / maxLoadFactor) + 1);
+        size_t result = DEFAULT_BUCKET_SIZE;
+        while (result < lower) {
+            if (result > (SIZE_MAX >> 1)) throw std::range_error("Out of Range");
+            result <<= 1;
+        }
+        return result;
+    }
+
+    void copyFrom(const RobinHoodHashTable &that) {
+        probeFloor = that.probeFloor;
+        allocate(that.capacity);
+        for (size_t i = 0; i < slotCount; i++) {
+            distances[i] = that.distances[i];
+            if (distances[i] != 0) new(slots + i) HashNode(that.slots[i]);
+        }
+        maxProbe = that.maxProbe;
+        tableSize = that.tableSize;
+    }
+
+public:
+    RobinHoodHashTable() :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(DEFAULT_BUCKET_SIZE);
+    }
+
+    explicit RobinHoodHashTable(size_t bucketSize) :
+            maxLoadFactor(DEFAULT_LOAD_FACTOR), hash(Hash()), keyEqual(KeyEqual()) {
+        allocate(findMinimumBucketSize(bucketSize));
+    }
+
+    RobinHoodHashTable(const RobinHoodHashTable &that) :
+            maxLoadFactor(that.maxLoadFactor), hash(that.hash), keyEqual(that.keyEqual) {
+        copyFrom(that);
+    }
+
+    RobinHoodHashTable &operator=(const RobinHoodHashTable &that) {
+        if (this == &that) return *this;
+        deallocate();
+        maxLoadFactor = that.maxLoadFactor;
+        hash = that.hash;
+        keyEqual = that.keyEqual;
+        copyFrom(that);
+        return *this;
+    }
+
+    ~RobinHoodHashTable() { deallocate(); }
+
+    Iterator begin() {
+        Iterator it(this, 0, false);
+        if (distances[0] == 0) it.increment();
+        return it;
+    }
+
+    Iterator end() {
+        return Iterator(this, slotCount, true);
+    }
+
+    /**
+     * Find whether the key exists in the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists in the hashtable
+     */
+    bool contains(const Key &key) {
+        return find(key) != end();
+    }
+
+    /**
+     * Find the value in hashtable by key
+     * If the key exists, iterator points to the corresponding value, and it.endFlag = false
+     * Otherwise, iterator points to the slot that the key were to be inserted, and it.endFlag = true
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return an iterator of the value
+     */
+    Iterator find(const Key &key) {
+        size_t index = home(key);
+        for (size_t distance = 1;; index++, distance++) {
+            //the Robin Hood order ends the probe, no later slot can hold the key; every slot past maxProbe
+            //holds an element closer to its home, so this stops within maxProbe + 1 slots without checking it
+            if (distances[index] < distance) return Iterator(this, index, true);
+            if (distances[index] == distance && keyEqual(slots[index].first, key)) return Iterator(this, index, false);
+        }
+    }
+
+    /**
+     * Insert value into the hashtable according to an iterator returned by find
+     * the function can be only be called if no other write actions are done to the hashtable after the find
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: O(k)
+     * @throw std::range_error if MAX_PROBE_LIMIT keys with the same hash value as key are in the hashtable,
+     * then nothing is changed
+     * @param it an iterator returned by find
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Iterator &it, const Key &key, const Value &value) {
+        if (!it.endFlag) {
+            slots[it.index].second = value;
+            return false;
+        }
+        std::optional<HashNode> carried;
+        carried.emplace(key, value);
+        ++tableSize;
+        if (!place(carried, it.index, it.index - home(key) + 1)) {
+            try {
+                reinsert(carried);
+            }
+            catch (const std::range_error &) {
+                //only the new key can be one too many for its hash value, and it is still carried
+                --tableSize;
+                throw;
+            }
+        }
+        if ((double) tableSize > maxLoadFactor * (double) capacity) rehash(capacity);
+        return true;
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        return insert(find(key), key, value);
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * DO NOT rehash in this function
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) return false;
+        erase(it);
+        return true;
+    }
+
+    /**
+     * Erase the key at the input iterator
+     * If the input iterator is the end iterator, do nothing and return the input iterator directly
+     * The following elements not at their home are shifted back by one slot
+     * Time Complexity: O(1) expected
+     * @param it
+     * @return the iterator after the input iterator before the erase
+     */
+    Iterator erase(const Iterator &it) {
+        if (it.endFlag) return it;
+        size_t index = it.index;
+        slots[index].~HashNode();
+        for (; distances[index + 1] > 1; index++) {
+            new(slots + index) HashNode(std::move(slots[index + 1]));
+            slots[index + 1].~HashNode();
+            distances[index] = (Distance) (distances[index + 1] - 1);
+        }
+        distances[index] = 0;
+        --tableSize;
+        //the next element, if shifted, is now at it.index, and the slots never wrap around
+        Iterator next(this, it.index, false);
+        if (distances[it.index] == 0) next.increment();
+        return next;
+    }
+
+    /**
+     * Get the reference of value by key in the hashtable
+     * If the key doesn't exist, create it first (use default constructor of Value)
+     * If load factor exceeds maximum value, rehash the hashtable
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return reference of value
+     */
+    Value &operator[](const Key &key) {
+        Iterator it = find(key);
+        if (it.endFlag) {
+            insert(it, key, Value());
+            it = find(key);
+        }
+        return it->second;
+    }
+
+    /**
+     * Rehash the hashtable according to the (hinted) number of home slots
+     * The number of slots after rehash need not be same as the parameter bucketSize
+     * Instead, findMinimumBucketSize is called to get the correct number
+     * Do nothing if the number of slots doesn't change
+     * Time Complexity: O(nk)
+     * @param bucketSize lower bound of the new number of home slots
+     */
+    void rehash(size_t bucketSize) {
+        bucketSize = findMinimumBucketSize(bucketSize);
+        if (bucketSize == capacity) return;
+        rebuild(bucketSize);
+    }
+
+    /**
+     * @return the number of elements in the hashtable
+     */
+    size_t size() const { return tableSize; }
+
+    /**
+     * @return the number of home slots in the hashtable
+     */
+    size_t bucketSize() const { return capacity; }
+
+    /**
+     * @return the current load factor of the hashtable
+     */
+    double loadFactor() const { return (double) tableSize / (double) capacity; }
+
+    /**
+     * @return the maximum load factor of the hashtable
+     */
+    double getMaxLoadFactor() const { return maxLoadFactor; }
+
+    /**
+     * Only reported: find is ended by the Robin Hood order, which already bounds it by this plus one
+     * @return the longest probe length since the last rehash, an upper bound of the current one
+     */
+    size_t maxProbeLength() const { return maxProbe; }
+
+    /**
+     * Set the max load factor
+     * @throw std::range_error if the load factor is too small or too large
+     * @param loadFactor
+     */
+    void setMaxLoadFactor(double loadFactor) {
+        if (loadFactor <= 1e-9 || loadFactor > 0.95) {
+            throw std::range_error("invalid load factor!");
+        }
+        maxLoadFactor = loadFactor;
+        rehash(capacity);
+    }
+};
+
+#endif //VE281P2_ROBIN_HOOD_HASHTABLE_HPP
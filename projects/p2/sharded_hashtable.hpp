@@ -0,0 +1,378 @@
+#ifndef VE281P2_SHARDED_HASHTABLE_HPP
+#define VE281P2_SHARDED_HASHTABLE_HPP
+
+#include "hash_functions.hpp"
+#include "hashtable.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * A hashtable split into independent HashTable shards (hashtable.hpp), each with its own lock
+ * The shard of a key is chosen by the high bits of its mixed hash value, the bucket in the shard by the hash
+ * value itself, so the two choices don't depend on each other
+ * Threads working on keys of different shards share no lock, no bucket vector and no node pool, so they
+ * don't bounce each other's cache lines; every shard allocates its nodes from its own NodePool
+ * With first touch placement (Linux) a page lands on the NUMA node of the thread that first writes it: the nodes
+ * of a shard on the node of the threads that insert them, its bucket vector on the node of the thread that last
+ * sized it, which reserveOn chooses, while the small shard objects stay on the node of the constructing thread
+ * Operations on one key lock its shard; iteration takes no lock, and no writer may run during it
+ * The time complexity of functions are based on n and k
+ * n is the size of the hashtable
+ * k is the length of Key
+ * @tparam Key          key type
+ * @tparam Value        data type
+ * @tparam Hash         function object, return the hash value of a key
+ * @tparam KeyEqual     function object, return whether two keys are the same
+ * @tparam SizePolicy   possible numbers of buckets of a shard and the map from a hash value to a bucket
+ */
+template<
+        typename Key, typename Value,
+        typename Hash = std::hash<Key>,
+        typename KeyEqual = std::equal_to<Key>,
+        typename SizePolicy = HashPrime::PrimeSizePolicy
+>
+class ShardedHashTable {
+public:
+    typedef HashTable<Key, Value, Hash, KeyEqual, SizePolicy> ShardTable;
+    typedef typename ShardTable::HashNode HashNode;
+
+protected:
+    static constexpr size_t DEFAULT_SHARDS = 16;
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t HASH_BITS = 8 * sizeof(size_t);
+
+    // a shard and its lock, on cache lines of its own
+    struct alignas(CACHE_LINE) Shard {
+        std::mutex mutex;
+        ShardTable table;
+    };
+
+    std::vector<Shard> shards;
+    size_t shardBits;                           // log2 of the number of shards
+    Hash hash;                                  // hash function instance
+
+    size_t shardIndex(const Key &key) const {
+        if (shardBits == 0) return 0;
+        return (size_t) HashFunctions::mix(hash(key)) >> (HASH_BITS - shardBits);
+    }
+
+    Shard &shardOf(const Key &key) { return shards[shardIndex(key)]; }
+
+    /**
+     * Sort the indices of n keys by shard
+     * @param order set to the indices, the keys of shard s are order[start[s]] to order[start[s + 1] - 1]
+     * @param start set to the start of the keys of every shard in order, and one past the end
+     */
+    void groupByShard(const Key *keys, size_t n, std::vector<size_t> &order, std::vector<size_t> &start) const {
+        std::vector<size_t> index(n);
+        start.assign(shards.size() + 1, 0);
+        for (size_t i = 0; i < n; i++) ++start[(index[i] = shardIndex(keys[i])) + 1];
+        for (size_t s = 0; s < shards.size(); s++) start[s + 1] += start[s];
+        order.resize(n);
+        std::vector<size_t> next(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < n; i++) order[next[index[i]]++] = i;
+    }
+
+public:
+    /**
+     * A single directional iterator over the shards one after another
+     */
+    class Iterator {
+    private:
+        typedef typename ShardTable::Iterator ShardIterator;
+
+        ShardedHashTable *hashTable;
+        size_t shard;               // the shard of it, shards.size() for the end iterator
+        ShardIterator it;
+
+        /**
+         * Move to the first element of the next non-empty shard, if it is at the end of its shard
+         * Time complexity: O(number of shards)
+         */
+        void skipEmpty() {
+            while (shard < hashTable->shards.size() && it == hashTable->shards[shard].table.end()) {
+                if (++shard < hashTable->shards.size()) it = hashTable->shards[shard].table.begin();
+            }
+        }
+
+        Iterator(ShardedHashTable *hashTable, size_t shard, ShardIterator it) :
+                hashTable(hashTable), shard(shard), it(it) {
+            skipEmpty();
+        }
+
+    public:
+        friend class ShardedHashTable;
+
+        Iterator() = delete;
+
+        Iterator(const Iterator &) = default;
+
+        Iterator &operator=(const Iterator &) = default;
+
+        Iterator &operator++() {
+            ++it;
+            skipEmpty();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        bool operator==(const Iterator &that) const {
+            if (shard != that.shard) return false;
+            return shard == hashTable->shards.size() || it == that.it;
+        }
+
+        bool operator!=(const Iterator &that) const {
+            return !(*this == that);
+        }
+
+        HashNode *operator->() {
+            return it.operator->();
+        }
+
+        HashNode &operator*() {
+            return *it;
+        }
+    };
+
+    /**
+     * @param shardCount lower bound of the number of shards, rounded up to a power of 2
+     */
+    explicit ShardedHashTable(size_t shardCount = DEFAULT_SHARDS) : shardBits(0), hash(Hash()) {
+        while (((size_t) 1 << shardBits) < shardCount) ++shardBits;
+        shards = std::vector<Shard>((size_t) 1 << shardBits);
+    }
+
+    ShardedHashTable(const ShardedHashTable &) = delete;
+
+    ShardedHashTable &operator=(const ShardedHashTable &) = delete;
+
+    /**
+     * No writer may run while the iterators are used
+     */
+    Iterator begin() {
+        return Iterator(this, 0, shards[0].table.begin());
+    }
+
+    Iterator end() {
+        return Iterator(this, shards.size(), shards.back().table.end());
+    }
+
+    /**
+     * Insert <key, value> into the hashtable
+     * If the key already exists, overwrite its value
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value
+     * @return whether insertion took place (return false if the key already exists)
+     */
+    bool insert(const Key &key, const Value &value) {
+        Shard &shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.table.insert(key, value);
+    }
+
+    /**
+     * Erase the key if it exists in the hashtable, otherwise, do nothing
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @return whether the key exists
+     */
+    bool erase(const Key &key) {
+        Shard &shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.table.erase(key);
+    }
+
+    /**
+     * Call function with the value of key, while the shard is locked
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param function called as function(Value &), it may change the value
+     * @return whether the key exists in the hashtable
+     */
+    template<typename Function>
+    bool visit(const Key &key, Function function) {
+        Shard &shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.table.find(key);
+        if (it == shard.table.end()) return false;
+        function(it->second);
+        return true;
+    }
+
+    /**
+     * Copy the value of key
+     * Time Complexity: Amortized O(k)
+     * @param key
+     * @param value set to the value of key if it exists
+     * @return whether the key exists in the hashtable
+     */
+    bool find(const Key &key, Value &value) {
+        return visit(key, [&value](const Value &found) { value = found; });
+    }
+
+    bool contains(const Key &key) {
+        return visit(key, [](const Value &) {});
+    }
+
+    /**
+     * Find n keys, locking each shard once: the keys are grouped by shard, and every group is searched
+     * with findBatch of its shard
+     * Time Complexity: Amortized O(nk + number of shards)
+     * @param keys
+     * @param n number of keys
+     * @param values set to the value of each key that exists
+     * @param found set to whether each key exists
+     * @return the number of keys found
+     */
+    size_t findBatch(const Key *keys, size_t n, Value *values, bool *found) {
+        std::vector<size_t> order, start;
+        groupByShard(keys, n, order, start);
+        std::vector<Key> group;
+        std::vector<Value *> out;
+        size_t count = 0;
+        for (size_t s = 0; s < shards.size(); s++) {
+            if (start[s] == start[s + 1]) continue;
+            group.clear();
+            for (size_t i = start[s]; i < start[s + 1]; i++) group.push_back(keys[order[i]]);
+            out.resize(group.size());
+            std::lock_guard<std::mutex> lock(shards[s].mutex);
+            count += shards[s].table.findBatch(group.data(), group.size(), out.data());
+            for (size_t i = 0; i < group.size(); i++) {
+                found[order[start[s] + i]] = out[i] != nullptr;
+                if (out[i]) values[order[start[s] + i]] = *out[i];
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Insert n pairs <keys[i], values[i]>, locking each shard once, in the same way as findBatch
+     * If a key appears twice, the later value is kept
+     * Time Complexity: Amortized O(nk + number of shards)
+     * @return the number of insertions that took place
+     */
+    size_t insertBatch(const Key *keys, const Value *values, size_t n) {
+        std::vector<size_t> order, start;
+        groupByShard(keys, n, order, start);
+        std::vector<Key> groupKeys;
+        std::vector<Value> groupValues;
+        size_t inserted = 0;
+        for (size_t s = 0; s < shards.size(); s++) {
+            if (start[s] == start[s + 1]) continue;
+            groupKeys.clear();
+            groupValues.clear();
+            for (size_t i = start[s]; i < start[s + 1]; i++) {
+                groupKeys.push_back(keys[order[i]]);
+                groupValues.push_back(values[order[i]]);
+            }
+            std::lock_guard<std::mutex> lock(shards[s].mutex);
+            inserted += shards[s].table.insertBatch(groupKeys.data(), groupValues.data(), groupKeys.size());
+        }
+        return inserted;
+    }
+
+    /**
+     * Call function on every element, the shards are shared among threads, each locked while it is visited
+     * function must be safe to call from several threads on elements of different shards
+     * Time Complexity: O(n / threads + number of buckets)
+     * @param function called as function(const Key &, Value &)
+     * @param threads number of threads, at most the number of shards are used
+     */
+    template<typename Function>
+    void forEach(Function function, size_t threads = std::thread::hardware_concurrency()) {
+        std::atomic<size_t> next(0);
+        auto work = [this, &next, &function]() {
+            for (size_t s; (s = next.fetch_add(1)) < shards.size();) {
+                std::lock_guard<std::mutex> lock(shards[s].mutex);
+                for (auto it = shards[s].table.begin(); it != shards[s].table.end(); ++it) {
+                    function(it->first, it->second);
+                }
+            }
+        };
+        threads = std::max<size_t>(1, std::min(threads, shards.size()));
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; t++) workers.emplace_back(work);
+        work();
+        for (auto &worker : workers) worker.join();
+    }
+
+    /**
+     * Make room for n elements in total, spread evenly over the shards
+     * Time Complexity: O(n) if a shard rehashes
+     */
+    void reserve(size_t n) {
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.table.reserve(n / shards.size() + 1);
+        }
+    }
+
+    /**
+     * Make room for n elements in total as reserve does, but shard s is sized by a thread pinned to the cpu
+     * cpus[s % cpus.size()], so that its bucket vector is first touched on the NUMA node of that cpu
+     * Give the cpus of the threads that will use each shard, before inserting into it
+     * Time Complexity: O(n / number of cpus) if the shards rehash
+     * @param n
+     * @param cpus cpu numbers as sched_setaffinity takes them, must not be empty
+     */
+    void reserveOn(size_t n, const std::vector<int> &cpus) {
+        auto work = [this, n, &cpus](size_t first) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[first], &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+            for (size_t s = first; s < shards.size(); s += cpus.size()) {
+                std::lock_guard<std::mutex> lock(shards[s].mutex);
+                shards[s].table.reserve(n / shards.size() + 1);
+            }
+        };
+        //a new thread per cpu, the calling thread keeps its own affinity
+        std::vector<std::thread> workers;
+        for (size_t first = 0; first < std::min(cpus.size(), shards.size()); first++) {
+            workers.emplace_back(work, first);
+        }
+        for (auto &worker : workers) worker.join();
+    }
+
+    /**
+     * @return the number of elements in the hashtable, each shard is counted under its lock
+     */
+    size_t size() {
+        size_t total = 0;
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.table.size();
+        }
+        return total;
+    }
+
+    /**
+     * @return the number of shards
+     */
+    size_t shardCount() const { return shards.size(); }
+
+    /**
+     * Direct access to a shard, not locked
+     */
+    ShardTable &shard(size_t index) { return shards[index].table; }
+};
+
+#endif //VE281P2_SHARDED_HASHTABLE_HPP